@@ -0,0 +1,278 @@
+/**
+    @file fft_batch_bench - batched real FFTs (one transform per SIMD lane) vs. one at a time
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    standalone, like fft_bench:
+        cc -O2 -I../source/convolve fft_batch_bench.c ../source/convolve/fft*.c -lm -lpthread -o fft_batch_bench
+        ./fft_batch_bench [max_log2n]
+
+    first, for every kernel set the CPU supports, it runs a batch of as many transforms as a vector
+    holds through `fft_zrip_batch` (interleaving and de-interleaving included) and the same signals
+    through `fft_zrip` one by one, and reports the time per forward + inverse pair both ways and the
+    largest difference between the two results.
+
+    then, with the detected kernels, it times the job the batches were meant for: the partitions
+    of an impulse response (n/2 samples zero-padded to n, as in `conv_ols_new`), one by one through
+    `fft_zrip_pruned` and `fft_zrip_scrambled` (what the engines run) vs. in batches. the single
+    transforms skip the zero half and the scrambled ones the bit reversal, which batches can't, so
+    a batch has to beat the faster of the two to be worth using there.
+
+    exits with 1 if any result differs by more than BENCH_TOLERANCE.
+*/
+
+#include "fft.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_TOLERANCE 1e-5    // largest difference allowed, relative to the peak of the result
+#define BENCH_PARTITIONS 64     // impulse response partitions in the second table
+
+static double bench_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec;
+}
+
+/* largest difference between two vectors, relative to the peak of the first */
+static double bench_difference(const float* expected, const float* actual, long count) {
+    double peak = 0., error = 0.;
+
+    for (long i = 0; i < count; i++) {
+        if (fabs(expected[i]) > peak) peak = fabs(expected[i]);
+        if (fabs(expected[i] - actual[i]) > error) error = fabs(expected[i] - actual[i]);
+    }
+
+    return error/(peak > 0. ? peak : 1.);
+}
+
+/* seconds per forward + inverse pair of each of `count` signals, through `fft_zrip` (batch NULL)
+   or `fft_zrip_batch` */
+static double bench_time(const t_fft_setup* setup, t_fft_split* spectra, long count, t_fft_split* batch, long stride, long log2n) {
+    long m = 1L << (log2n - 1);
+    long reps = 1;
+    double elapsed = 0.;
+
+    /* double the repetitions until a run takes long enough to time reliably */
+    while (1) {
+        double start = bench_now();
+        for (long r = 0; r < reps; r++) {
+            if (batch) {
+                fft_batch_interleave(spectra, count, batch, stride, m);
+                fft_zrip_batch(setup, batch, log2n, FFT_FORWARD, stride);
+                fft_zrip_batch(setup, batch, log2n, FFT_INVERSE, stride);
+                fft_vsmul(batch->realp, 0.5f/(2*m), m*stride);
+                fft_vsmul(batch->imagp, 0.5f/(2*m), m*stride);
+                fft_batch_deinterleave(batch, stride, spectra, count, m);
+            } else {
+                for (long t = 0; t < count; t++) {
+                    fft_zrip(setup, spectra + t, log2n, FFT_FORWARD);
+                    fft_zrip(setup, spectra + t, log2n, FFT_INVERSE);
+                    fft_vsmul(spectra[t].realp, 0.5f/(2*m), m);
+                    fft_vsmul(spectra[t].imagp, 0.5f/(2*m), m);
+                }
+            }
+        }
+        elapsed = bench_now() - start;
+        if (elapsed > 0.2) break;
+        reps *= 2;
+    }
+
+    return elapsed/reps/count;
+}
+
+/* `fft_zrip_batch` against `fft_zrip`, forward and inverse, for the active kernels (-1 if it couldn't run) */
+static double bench_batch_error(const t_fft_setup* setup, const float* signal, long log2n) {
+    long m = 1L << (log2n - 1);
+    long stride = fft_batch_stride(1);
+    float* single = (float*)malloc(sizeof(float)*2*m*stride);
+    float* batched = (float*)malloc(sizeof(float)*2*m*stride);
+    float* work = (float*)malloc(sizeof(float)*2*m*stride);
+    t_fft_split spectra[16], outputs[16], batch = {work, work + m*stride};
+    double error = -1.;
+
+    static const int directions[2] = { FFT_FORWARD, FFT_INVERSE };
+
+    if (single && batched && work && stride <= 16) {
+        error = 0.;
+
+        for (int d = 0; d < 2; d++) {
+            int direction = directions[d];
+
+            for (long t = 0; t < stride; t++) {
+                spectra[t].realp = single + 2*m*t;
+                spectra[t].imagp = single + 2*m*t + m;
+                outputs[t].realp = batched + 2*m*t;
+                outputs[t].imagp = batched + 2*m*t + m;
+                fft_ctoz(signal + 2*m*t, spectra + t, 2*m);
+            }
+
+            fft_batch_interleave(spectra, stride, &batch, stride, m);
+            fft_zrip_batch(setup, &batch, log2n, direction, stride);
+            fft_batch_deinterleave(&batch, stride, outputs, stride, m);
+            for (long t = 0; t < stride; t++) fft_zrip(setup, spectra + t, log2n, direction);
+
+            for (long t = 0; t < stride; t++) {
+                double e = bench_difference(single + 2*m*t, batched + 2*m*t, 2*m);
+                if (e > error) error = e;
+            }
+        }
+    }
+
+    free(work);
+    free(batched);
+    free(single);
+    return error;
+}
+
+/* one run of `BENCH_PARTITIONS` forward transforms of the spectra in `data` (n floats each): one by
+   one through `fft_zrip_pruned` (method 0) or `fft_zrip_scrambled` (1), or in batches (2) */
+static void bench_partitions_run(const t_fft_setup* setup, float* data, float* work, long log2n, int method) {
+    long n = 1L << log2n;
+    long m = n/2;
+    long stride = fft_batch_stride(1);
+    t_fft_split group[16], batch = {work, work + m*stride};
+
+    for (long first = 0; first < BENCH_PARTITIONS; first += method == 2 ? stride : 1) {
+        long lanes = method == 2 ? (BENCH_PARTITIONS - first < stride ? BENCH_PARTITIONS - first : stride) : 1;
+
+        for (long t = 0; t < lanes; t++) {
+            group[t].realp = data + n*(first + t);
+            group[t].imagp = group[t].realp + m;
+        }
+
+        if (method == 0) {
+            fft_zrip_pruned(setup, group, log2n, FFT_FORWARD, m);
+        } else if (method == 1) {
+            fft_zrip_scrambled(setup, group, log2n, m);
+        } else {
+            fft_batch_interleave(group, lanes, &batch, stride, m);
+            fft_zrip_batch(setup, &batch, log2n, FFT_FORWARD, stride);
+            fft_batch_deinterleave(&batch, stride, group, lanes, m);
+        }
+    }
+}
+
+/* the partitions of an impulse response (n/2 samples each, zero-padded to n) as `conv_ols_new`
+   transforms them: seconds per partition for each method of `bench_partitions_run`, and the largest
+   difference between the batches and `fft_zrip_pruned` (-1 if it couldn't run) */
+static double bench_partitions(const t_fft_setup* setup, long log2n, const float* signal, double* seconds) {
+    long n = 1L << log2n;
+    long size = n*BENCH_PARTITIONS;
+    float* input = (float*)malloc(sizeof(float)*size);
+    float* single = (float*)malloc(sizeof(float)*size);
+    float* batched = (float*)malloc(sizeof(float)*size);
+    float* work = (float*)malloc(sizeof(float)*16*n);
+    double error = -1.;
+
+    if (input && single && batched && work && fft_batch_stride(1) <= 16) {
+        for (long p = 0; p < BENCH_PARTITIONS; p++) {
+            t_fft_split spectrum = {input + n*p, input + n*p + n/2};
+            memset(input + n*p, 0, sizeof(float)*n);
+            fft_ctoz(signal + n/2*p, &spectrum, n/2);
+        }
+
+        for (int method = 0; method < 3; method++) {
+            long reps = 1;
+            double elapsed;
+
+            /* (the copy back to the input is timed as well, but it's the same for every method) */
+            while (1) {
+                double start = bench_now();
+                for (long r = 0; r < reps; r++) {
+                    memcpy(batched, input, sizeof(float)*size);
+                    bench_partitions_run(setup, batched, work, log2n, method);
+                }
+                elapsed = bench_now() - start;
+                if (elapsed > 0.2) break;
+                reps *= 2;
+            }
+
+            seconds[method] = elapsed/reps/BENCH_PARTITIONS;
+        }
+
+        memcpy(single, input, sizeof(float)*size);
+        memcpy(batched, input, sizeof(float)*size);
+        bench_partitions_run(setup, single, work, log2n, 0);
+        bench_partitions_run(setup, batched, work, log2n, 2);
+        error = bench_difference(single, batched, size);
+    }
+
+    free(work);
+    free(batched);
+    free(single);
+    free(input);
+    return error;
+}
+
+int main(int argc, char** argv) {
+    long max_log2n = argc > 1 ? atol(argv[1]) : 16;
+    long n_max = 1L << max_log2n;
+    long samples = n_max*BENCH_PARTITIONS/2 > 16*n_max ? n_max*BENCH_PARTITIONS/2 : 16*n_max;
+    t_fft_setup* setup = fft_setup_new(max_log2n);
+    float* signal = (float*)malloc(sizeof(float)*samples);
+    float* data = (float*)malloc(sizeof(float)*16*n_max);
+    float* work = (float*)malloc(sizeof(float)*16*n_max);
+    int failed = 0;
+
+    if (!setup || !signal || !data || !work) {
+        fprintf(stderr, "could not allocate a setup for 2^%ld\n", max_log2n);
+        return 1;
+    }
+
+    srand(1);
+    for (long i = 0; i < samples; i++) signal[i] = (float)rand()/(float)RAND_MAX - 0.5f;
+
+    /* every kernel set this machine can run, scalar first */
+    static const char* names[] = { "scalar", "sse2", "neon", "avx2", "avx512" };
+
+    for (long k = 0; k < 5; k++) {
+        if (fft_force_kernel(names[k])) continue;
+
+        long stride = fft_batch_stride(1);
+        printf("%s (%ld lanes)\n%10s %12s %12s %8s %10s\n", names[k], stride, "n", "single us", "batch us", "speedup", "error");
+
+        for (long log2n = 6; log2n <= max_log2n; log2n++) {
+            long m = 1L << (log2n - 1);
+            t_fft_split spectra[16], batch = {work, work + m*stride};
+            double t_single, t_batch, error;
+
+            for (long t = 0; t < stride; t++) {
+                spectra[t].realp = data + 2*m*t;
+                spectra[t].imagp = data + 2*m*t + m;
+                fft_ctoz(signal + 2*m*t, spectra + t, 2*m);
+            }
+
+            t_single = bench_time(setup, spectra, stride, NULL, stride, log2n);
+            t_batch = bench_time(setup, spectra, stride, &batch, stride, log2n);
+            error = bench_batch_error(setup, signal, log2n);
+            failed |= error < 0. || error > BENCH_TOLERANCE;
+
+            printf("%10ld %12.2f %12.2f %7.2fx %10.2e\n", 2*m, 1e6*t_single, 1e6*t_batch, t_single/t_batch, error);
+        }
+        printf("\n");
+    }
+
+    fft_init();
+    printf("%ld half-empty partitions, one by one vs. in batches (%s)\n%10s %12s %12s %12s %8s %10s\n",
+           (long)BENCH_PARTITIONS, fft_kernel_name(), "n", "pruned us", "scrambled us", "batch us", "speedup", "error");
+
+    for (long log2n = 6; log2n <= max_log2n; log2n++) {
+        double seconds[3] = {0., 0., 0.};
+        double error = bench_partitions(setup, log2n, signal, seconds);
+        double fastest = seconds[0] < seconds[1] ? seconds[0] : seconds[1];
+
+        failed |= error < 0. || error > BENCH_TOLERANCE;
+        printf("%10ld %12.2f %12.2f %12.2f %7.2fx %10.2e\n", 1L << log2n, 1e6*seconds[0], 1e6*seconds[1], 1e6*seconds[2],
+               fastest/seconds[2], error);
+    }
+
+    free(work);
+    free(data);
+    free(signal);
+    fft_setup_free(setup);
+    return failed;
+}
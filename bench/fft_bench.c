@@ -0,0 +1,133 @@
+/**
+    @file fft_bench - throughput of the portable real FFT (each SIMD kernel set vs. the scalar reference)
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    this is a standalone program (no Max required), so it runs anywhere the engine does:
+        cc -O2 -I../source/convolve fft_bench.c ../source/convolve/fft*.c -lm -lpthread -o fft_bench
+        ./fft_bench [max_log2n]
+
+    for every size it reports the time per real forward + inverse pair and the usual
+    2.5*n*log2(n) "mflops" figure for every kernel set the CPU supports, the speedup of the
+    fastest one over the scalar reference, and the round trip error of the detected kernels.
+*/
+
+#include "fft.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double bench_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec;
+}
+
+/* seconds per forward + inverse pair of length 2^log2n */
+static double bench_time(const t_fft_setup* setup, t_fft_split* spectrum, long log2n) {
+    long n = 1L << log2n;
+    long reps = 1;
+    double elapsed = 0.;
+
+    /* double the repetitions until a run takes long enough to time reliably */
+    while (1) {
+        double start = bench_now();
+        for (long r = 0; r < reps; r++) {
+            fft_zrip(setup, spectrum, log2n, FFT_FORWARD);
+            fft_zrip(setup, spectrum, log2n, FFT_INVERSE);
+            fft_vsmul(spectrum->realp, 0.5f/n, n/2);
+            fft_vsmul(spectrum->imagp, 0.5f/n, n/2);
+        }
+        elapsed = bench_now() - start;
+        if (elapsed > 0.2) break;
+        reps *= 2;
+    }
+
+    return elapsed/reps;
+}
+
+/* largest error of a forward/inverse round trip (should be around 1e-7 for float) */
+static double bench_roundtrip_error(const t_fft_setup* setup, t_fft_split* spectrum, const float* signal, long log2n) {
+    long n = 1L << log2n;
+    float* out = (float*)malloc(sizeof(float)*n);
+    double error = 0.;
+
+    fft_ctoz(signal, spectrum, n);
+    fft_zrip(setup, spectrum, log2n, FFT_FORWARD);
+    fft_zrip(setup, spectrum, log2n, FFT_INVERSE);
+    fft_ztoc(spectrum, out, n);
+
+    for (long i = 0; i < n; i++) {
+        double e = fabs(out[i]/(2.0*n) - signal[i]);
+        if (e > error) error = e;
+    }
+
+    free(out);
+    return error;
+}
+
+int main(int argc, char** argv) {
+    long max_log2n = argc > 1 ? atol(argv[1]) : 22;
+    long n_max = 1L << max_log2n;
+    t_fft_setup* setup = fft_setup_new(max_log2n);
+    float* signal = (float*)malloc(sizeof(float)*n_max);
+    t_fft_split spectrum;
+
+    spectrum.realp = (float*)malloc(sizeof(float)*n_max/2);
+    spectrum.imagp = (float*)malloc(sizeof(float)*n_max/2);
+
+    if (!setup || !signal || !spectrum.realp || !spectrum.imagp) {
+        fprintf(stderr, "could not allocate a setup for 2^%ld\n", max_log2n);
+        return 1;
+    }
+
+    srand(1);
+    for (long i = 0; i < n_max; i++) signal[i] = (float)rand()/(float)RAND_MAX - 0.5f;
+
+    /* every kernel set this machine can run, scalar first */
+    static const char* names[] = { "scalar", "sse2", "neon", "avx2", "avx512" };
+    const char* kernels[5];
+    long nkernels = 0;
+
+    for (long k = 0; k < 5; k++) {
+        if (!fft_force_kernel(names[k])) kernels[nkernels++] = names[k];
+    }
+
+    fft_init();
+    printf("detected kernels: %s\n\n", fft_kernel_name());
+
+    printf("%10s", "n");
+    for (long k = 0; k < nkernels; k++) printf(" %10s us %8s", kernels[k], "mflops");
+    printf(" %8s %10s\n", "speedup", "error");
+
+    for (long log2n = 6; log2n <= max_log2n; log2n++) {
+        long n = 1L << log2n;
+        double flops = 2.0*2.5*(double)n*(double)log2n;   // forward + inverse
+        double t_scalar = 0., t_best = 0., error;
+
+        fft_ctoz(signal, &spectrum, n);
+        printf("%10ld", n);
+
+        for (long k = 0; k < nkernels; k++) {
+            double t;
+
+            fft_force_kernel(kernels[k]);
+            t = bench_time(setup, &spectrum, log2n);
+            printf(" %13.2f %8.0f", 1e6*t, 1e-6*flops/t);
+
+            if (k == 0) t_scalar = t;
+            if (k == 0 || t < t_best) t_best = t;
+        }
+
+        fft_init();
+        error = bench_roundtrip_error(setup, &spectrum, signal, log2n);
+        printf(" %7.2fx %10.2e\n", t_scalar/t_best, error);
+    }
+
+    free(spectrum.imagp);
+    free(spectrum.realp);
+    free(signal);
+    fft_setup_free(setup);
+    return 0;
+}
@@ -0,0 +1,101 @@
+/**
+    @file fft_exact_test - convolutions at awkward exact lengths (the `exact` attribute's path)
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    standalone, like fft_bench:
+        cc -O2 -I../source/convolve fft_exact_test.c ../source/convolve/fft*.c -lm -lpthread -o fft_exact_test
+        ./fft_exact_test
+
+    for a few signal and impulse response lengths whose N1 + N2 - 1 has a large prime factor, it
+    checks that `fft_good_size` pads while `fft_exact_size` keeps the exact length, then convolves
+    at that length (so through Rader or Bluestein, see fft_chirp.c) the way `convolve_fft` does,
+    with setups from `fft_cache_acquire`, and compares the result with a direct convolution in
+    double precision. exits with 1 on a mismatch.
+*/
+
+#include "fft.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_TOLERANCE 1e-5     // largest error allowed, relative to the result's peak
+
+/* largest error of the convolution at length n, relative to the peak (or -1 if it couldn't run) */
+static double test_convolve(long length1, long length2, long n) {
+    long out_length = length1 + length2 - 1;
+    t_fft_dft_setup* forward = fft_cache_acquire(n, FFT_FORWARD);
+    t_fft_dft_setup* inverse = fft_cache_acquire(n, FFT_INVERSE);
+    float* x = (float*)calloc(length1, sizeof(float));
+    float* h = (float*)calloc(length2, sizeof(float));
+    float* y = (float*)calloc(2*n, sizeof(float));      // both spectra, then the result
+    double* reference = (double*)calloc(out_length, sizeof(double));
+    double peak = 0., error = -1.;
+    t_fft_split a, b;
+
+    if (forward && inverse && x && h && y && reference) {
+        srand(1);
+        for (long i = 0; i < length1; i++) x[i] = (float)rand()/RAND_MAX - 0.5f;
+        for (long i = 0; i < length2; i++) h[i] = (float)rand()/RAND_MAX - 0.5f;
+
+        for (long i = 0; i < length1; i++) {
+            for (long j = 0; j < length2; j++) reference[i + j] += (double)x[i]*h[j];
+        }
+
+        /* zero-padded to n, packed as in `init_spectrum` */
+        a.realp = y;
+        a.imagp = y + n/2;
+        b.realp = y + n;
+        b.imagp = y + 3*n/2;
+        fft_ctoz(x, &a, length1);
+        fft_ctoz(h, &b, length2);
+
+        /* same steps as `convolve_fft`: forward (x2) times forward (x2), then the inverse (xn) */
+        fft_dft_execute_scrambled(forward, &a, length1);
+        fft_dft_execute_scrambled(forward, &b, length2);
+        fft_dft_execute_product_scrambled(inverse, &a, &b, &a, out_length);
+        fft_ztoc(&a, y + n, n);
+
+        error = 0.;
+        for (long i = 0; i < out_length; i++) {
+            double e = fabs((double)y[n + i]/(4.0*(double)n) - reference[i]);
+
+            if (fabs(reference[i]) > peak) peak = fabs(reference[i]);
+            if (e > error) error = e;
+        }
+        error /= peak > 0. ? peak : 1.;
+    }
+
+    fft_cache_release(inverse);
+    fft_cache_release(forward);
+    free(reference);
+    free(y);
+    free(h);
+    free(x);
+    return error;
+}
+
+int main(void) {
+    /* N1 + N2 - 1 = 2*1009 (prime, 1008 factors: Rader), 2*1013 (1012 = 4*11*23: Bluestein),
+       and an odd 4093 (2047 = 23*89 after rounding up to 4094: Bluestein) */
+    static const long lengths[][2] = { {1500, 519}, {1500, 527}, {4000, 94} };
+    int failed = 0;
+
+    fft_init();
+
+    for (unsigned i = 0; i < sizeof(lengths)/sizeof(lengths[0]); i++) {
+        long length1 = lengths[i][0], length2 = lengths[i][1];
+        long out_length = length1 + length2 - 1;
+        long good = fft_good_size(out_length);
+        long exact = fft_exact_size(out_length);
+        double error = test_convolve(length1, length2, exact);
+        int ok = exact == (out_length + 1)/2*2 && good > exact && error >= 0. && error < TEST_TOLERANCE;
+
+        printf("%5ld + %4ld - 1 = %5ld: good size %5ld, exact size %5ld, error %.2e  %s\n",
+               length1, length2, out_length, good, exact, error, ok ? "ok" : "FAILED");
+        failed |= !ok;
+    }
+
+    return failed;
+}
@@ -0,0 +1,101 @@
+/**
+    @file fft_sixstep_bench - where the six-step FFT starts beating the in-place radix-4 engine
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    standalone, like fft_bench:
+        cc -O2 -I../source/convolve fft_sixstep_bench.c ../source/convolve/fft*.c -lm -lpthread -o fft_sixstep_bench
+        ./fft_sixstep_bench [max_log2n]
+
+    for every power-of-two length it times a real forward + inverse pair both ways, and reports the
+    smallest length from which the six-step path stays faster. that's the value to use for
+    FFT_SIXSTEP_LOG2N (fft_private.h) on this machine; it moves with the size of the last-level cache.
+*/
+
+#include "fft.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double bench_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec;
+}
+
+/* seconds per forward + inverse pair of length 2^log2n */
+static double bench_time(const t_fft_setup* setup, t_fft_split* spectrum, long log2n) {
+    long n = 1L << log2n;
+    long reps = 1;
+    double elapsed = 0.;
+
+    while (1) {
+        double start = bench_now();
+        for (long r = 0; r < reps; r++) {
+            fft_zrip(setup, spectrum, log2n, FFT_FORWARD);
+            fft_zrip(setup, spectrum, log2n, FFT_INVERSE);
+            fft_vsmul(spectrum->realp, 0.5f/n, n/2);
+            fft_vsmul(spectrum->imagp, 0.5f/n, n/2);
+        }
+        elapsed = bench_now() - start;
+        if (elapsed > 0.3) break;
+        reps *= 2;
+    }
+
+    return elapsed/reps;
+}
+
+int main(int argc, char** argv) {
+    long max_log2n = argc > 1 ? atol(argv[1]) : 26;
+    long n_max = 1L << max_log2n;
+    long crossover = 0;
+    t_fft_setup* setup = fft_setup_new(max_log2n);
+    float* signal = (float*)malloc(sizeof(float)*n_max);
+    t_fft_split spectrum;
+
+    spectrum.realp = (float*)malloc(sizeof(float)*n_max/2);
+    spectrum.imagp = (float*)malloc(sizeof(float)*n_max/2);
+
+    if (!setup || !signal || !spectrum.realp || !spectrum.imagp) {
+        fprintf(stderr, "could not allocate a setup for 2^%ld\n", max_log2n);
+        return 1;
+    }
+
+    srand(1);
+    for (long i = 0; i < n_max; i++) signal[i] = (float)rand()/(float)RAND_MAX - 0.5f;
+
+    fft_init();
+    printf("kernels: %s, current threshold: 2^%ld\n\n", fft_kernel_name(), fft_sixstep_log2n());
+    printf("%10s %14s %14s %8s\n", "n", "radix-4 ms", "six-step ms", "ratio");
+
+    for (long log2n = 12; log2n <= max_log2n; log2n++) {
+        long n = 1L << log2n;
+        double t_radix4, t_sixstep;
+
+        fft_ctoz(signal, &spectrum, n);
+
+        fft_set_sixstep_log2n(max_log2n + 1);
+        t_radix4 = bench_time(setup, &spectrum, log2n);
+        fft_set_sixstep_log2n(1);
+        t_sixstep = bench_time(setup, &spectrum, log2n);
+
+        printf("%10ld %14.3f %14.3f %7.2fx\n", n, 1e3*t_radix4, 1e3*t_sixstep, t_radix4/t_sixstep);
+
+        /* the crossover is where six-step starts winning for good */
+        if (t_sixstep < t_radix4) {
+            if (!crossover) crossover = log2n;
+        } else {
+            crossover = 0;
+        }
+    }
+
+    if (crossover) printf("\nsix-step is faster from 2^%ld\n", crossover);
+    else printf("\nsix-step never won up to 2^%ld\n", max_log2n);
+
+    fft_set_sixstep_log2n(0);
+    free(spectrum.imagp);
+    free(spectrum.realp);
+    free(signal);
+    fft_setup_free(setup);
+    return 0;
+}
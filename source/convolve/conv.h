@@ -0,0 +1,94 @@
+/**
+    @file conv - convolution engines for convolve, built on the FFT in fft.h
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    every engine computes the plain linear convolution (no scaling or normalization), one block of
+    output at a time, so the memory it needs depends on the impulse response and the block size
+    rather than on the length of the signal.
+
+    like fft.h, nothing in here depends on the Max SDK.
+*/
+
+#ifndef CONVOLVE_CONV_H
+#define CONVOLVE_CONV_H
+
+#include "fft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* direct convolution for short impulse responses (see conv_fir.c) */
+void conv_direct(const float* signal, long signal_length, const float* ir, long ir_length, float* out, long out_length);
+
+/* uniformly partitioned overlap-save (see conv_ols.c) */
+typedef struct _conv_ols t_conv_ols;
+
+t_conv_ols* conv_ols_new(const float* ir, long ir_length, long block);
+t_conv_ols* conv_ols_clone(const t_conv_ols* ols);
+void conv_ols_free(t_conv_ols* ols);
+long conv_ols_block(const t_conv_ols* ols);
+void conv_ols_reset(t_conv_ols* ols);
+void conv_ols_process(t_conv_ols* ols, const float* in, float* out);
+void conv_ols_run(t_conv_ols* ols, const float* in, long in_length, float* out, long out_length);
+void conv_ols_run_parallel(t_conv_ols* ols, const float* in, long in_length, float* out, long out_length);
+long conv_ols_block_size(long ir_length);
+double conv_ols_cost(long ir_length, long block);
+
+/* non-uniformly partitioned overlap-save: short partitions first, longer ones later (see conv_nupols.c) */
+typedef struct _conv_nupols t_conv_nupols;
+
+t_conv_nupols* conv_nupols_new(const float* ir, long ir_length, long block, long max_block);
+void conv_nupols_free(t_conv_nupols* nu);
+long conv_nupols_block(const t_conv_nupols* nu);
+void conv_nupols_reset(t_conv_nupols* nu);
+void conv_nupols_process(t_conv_nupols* nu, const float* in, float* out);
+void conv_nupols_run(t_conv_nupols* nu, const float* in, long in_length, float* out, long out_length);
+double conv_nupols_cost(long ir_length, long block, long max_block);
+
+/* convolution matrices: every output sums its inputs, each through its own impulse response (see conv_matrix.c) */
+short conv_matrix(const float* const* inputs, long in_count, long in_length, const float* const* irs, long ir_length,
+                  float* const* outputs, long out_count, long out_length);
+
+/* partitioned convolution matrices, each input's delay line shared by every output (see conv_mimo.c) */
+#define CONV_MIMO_MAX_CHANNELS 256
+
+typedef struct _conv_mimo t_conv_mimo;
+
+t_conv_mimo* conv_mimo_new(const float* const* irs, long ir_length, long inputs, long outputs, long block);
+void conv_mimo_free(t_conv_mimo* mimo);
+long conv_mimo_block(const t_conv_mimo* mimo);
+void conv_mimo_reset(t_conv_mimo* mimo);
+void conv_mimo_process(t_conv_mimo* mimo, const float* const* in, float* const* out);
+void conv_mimo_run(t_conv_mimo* mimo, const float* const* in, long in_length, float* const* out, long out_length);
+double conv_mimo_cost(long ir_length, long block, long inputs, long outputs);
+
+/* picking the cheapest of the above for a job, with per-machine calibration (see conv_plan.c) */
+enum {
+    CONV_METHOD_DIRECT = 0,     // conv_direct
+    CONV_METHOD_FFT,            // one transform over the whole result
+    CONV_METHOD_OLS,            // conv_ols (conv_mimo for matrices)
+    CONV_METHOD_NUPOLS,         // conv_nupols
+    CONV_METHOD_COUNT
+};
+
+typedef struct _conv_plan {
+    int     method;
+    long    block;      // OLS/NUPOLS: (first) partition length
+    long    length;     // FFT: transform length
+    double  seconds;    // estimated run time on this machine
+} t_conv_plan;
+
+void conv_plan(t_conv_plan* plan, long signal_length, long ir_length, long channels, long latency);
+void conv_plan_matrix(t_conv_plan* plan, long signal_length, long ir_length, long inputs, long outputs, long latency);
+void conv_plan_batch(t_conv_plan* plan, long signal_length, long ir_length, long latency);
+const char* conv_method_name(int method);
+short conv_calibrate(void);
+long conv_calibration_export(char* text, long size);
+void conv_calibration_import(const char* text);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONVOLVE_CONV_H */
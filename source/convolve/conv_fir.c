@@ -0,0 +1,81 @@
+/**
+    @file conv_fir - direct (time-domain) convolution
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    for a short impulse response the FFT paths spend most of their time on padding: a 16-tap
+    filter still costs two transforms per block. computing every output as a dot product is then
+    cheaper, and exact to the last bit of float arithmetic.
+
+    the dot products run on the active SIMD kernels (`fft_fir` in fft_radix4.h), which want a
+    correlation over contiguous memory: out[i] = sum of h[k]*x[i + k]. so the impulse response is
+    reversed once, and the signal is copied a chunk at a time into a staging buffer with taps - 1
+    zeros of history in front, which also takes care of both ends of the convolution.
+*/
+
+#include "conv.h"
+#include "fft_private.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CONV_FIR_CHUNK 4096     // outputs per pass through the staging buffer
+
+static void conv_direct_scalar(const float* signal, long signal_length, const float* ir, long ir_length, float* out, long out_length);
+
+/**
+ @method `conv_direct`
+ linear convolution of a signal with an impulse response, one dot product per output sample
+
+ - Parameters:
+    - signal: the signal
+    - signal_length: its length
+    - ir: the impulse response
+    - ir_length: its length
+    - out: where to write the convolution (must not overlap the inputs)
+    - out_length: number of samples to compute (signal_length + ir_length - 1 for all of them)
+*/
+void conv_direct(const float* signal, long signal_length, const float* ir, long ir_length, float* out, long out_length) {
+    long history = ir_length - 1;
+    float* reversed = (float*)malloc(sizeof(float)*ir_length);
+    float* staging = (float*)malloc(sizeof(float)*(CONV_FIR_CHUNK + history));
+
+    /* memory for a few thousand samples ran out: still get the result, just slower */
+    if (!reversed || !staging) {
+        free(reversed);
+        free(staging);
+        conv_direct_scalar(signal, signal_length, ir, ir_length, out, out_length);
+        return;
+    }
+
+    for (long k = 0; k < ir_length; k++) reversed[k] = ir[history - k];
+
+    /* output n needs signal[n - history ... n]; staging[j] holds signal[start - history + j] */
+    for (long start = 0; start < out_length; start += CONV_FIR_CHUNK) {
+        long count = out_length - start < CONV_FIR_CHUNK ? out_length - start : CONV_FIR_CHUNK;
+        long first = start - history;
+        long end = start + count;
+        long from = first > 0 ? first : 0;
+        long to = end < signal_length ? end : signal_length;
+
+        /* zeros before the signal starts and after it ends */
+        memset(staging, 0, sizeof(float)*(CONV_FIR_CHUNK + history));
+        if (to > from) memcpy(staging + (from - first), signal + from, sizeof(float)*(to - from));
+
+        fft_kernels->fir(staging, reversed, ir_length, out + start, count);
+    }
+
+    free(staging);
+    free(reversed);
+}
+
+/* one sum per output sample, straight from the definition */
+static void conv_direct_scalar(const float* signal, long signal_length, const float* ir, long ir_length, float* out, long out_length) {
+    for (long n = 0; n < out_length; n++) {
+        long first = n - signal_length + 1 > 0 ? n - signal_length + 1 : 0;
+        long last = n < ir_length - 1 ? n : ir_length - 1;
+        float sum = 0.f;
+
+        for (long k = first; k <= last; k++) sum += ir[k]*signal[n - k];
+        out[n] = sum;
+    }
+}
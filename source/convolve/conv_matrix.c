@@ -0,0 +1,121 @@
+/**
+    @file conv_matrix - convolution matrices (true stereo and the like) as single transforms
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    a matrix of M inputs and N outputs has an impulse response for every path from an input to an
+    output, and every output is the sum of its M paths:
+
+        out_o = sum over i of (in_i * h_io)
+
+    true stereo is the 2 x 2 case: L and R each feed both outputs through their own response (LL,
+    LR, RL, RR). doing that as M*N separate convolutions transforms every input N times and
+    transforms N*M results back. here each input is transformed once and kept, the products of
+    each output are summed as spectra, and only the sum goes back: M + M*N forward transforms and N
+    inverse ones, instead of 2*M*N forward and M*N inverse.
+
+    the spectra are only multiplied and summed, so like conv_ols.c they stay in the order the
+    forward transform leaves them in (see `fft_dft_execute_scrambled`).
+*/
+
+#include "conv.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void conv_matrix_spectrum(float* data, long n, t_fft_split* spectrum);
+static short conv_matrix_transform(const t_fft_dft_setup* forward, const float* samples, long length, float* data, long n);
+
+/**
+ @method `conv_matrix`
+ every output of a convolution matrix, with one transform over the whole result
+
+ - Parameters:
+    - inputs: `in_count` signals of `in_length` samples
+    - in_count: number of inputs (M)
+    - in_length: their length
+    - irs: the M*N impulse responses, the one from input i to output o at irs[i*out_count + o]
+      (NULL where there is no path)
+    - ir_length: their length
+    - outputs: `out_count` buffers for the results (must not overlap the inputs)
+    - out_count: number of outputs (N)
+    - out_length: number of samples to compute per output (in_length + ir_length - 1 for all of them)
+ - Returns: 0 on success, 1 if memory ran out (the outputs are then undefined)
+*/
+short conv_matrix(const float* const* inputs, long in_count, long in_length, const float* const* irs, long ir_length,
+                  float* const* outputs, long out_count, long out_length) {
+    long n = fft_good_size(in_length + ir_length - 1);
+    t_fft_dft_setup* forward = fft_cache_acquire(n, FFT_FORWARD);
+    t_fft_dft_setup* inverse = fft_cache_acquire(n, FFT_INVERSE);
+    float* spectra = (float*)malloc(sizeof(float)*n*(in_count + 2));
+    short failed = !forward || !inverse || !spectra;
+
+    if (!failed) {
+        float* path = spectra + n*in_count;     // one path's impulse response
+        float* sum = path + n;                  // one output's sum of products
+        t_fft_split x, h, acc;
+
+        /* every input once */
+        for (long i = 0; !failed && i < in_count; i++) {
+            failed = conv_matrix_transform(forward, inputs[i], in_length, spectra + n*i, n);
+        }
+
+        conv_matrix_spectrum(path, n, &h);
+        conv_matrix_spectrum(sum, n, &acc);
+
+        for (long o = 0; o < out_count; o++) {
+            float dc = 0.f, nyq = 0.f;
+            short first = 1;
+
+            for (long i = 0; i < in_count; i++) {
+                const float* ir = irs[i*out_count + o];
+                if (!ir) continue;
+
+                if ((failed = conv_matrix_transform(forward, ir, ir_length, path, n))) break;
+                conv_matrix_spectrum(spectra + n*i, n, &x);
+
+                /* bin 0 packs the real dc and nyquist bins, which are multiplied separately */
+                if (first) fft_zvmul(&x, &h, &acc, n/2);
+                else fft_zvma(&x, &h, &acc, &acc, n/2);
+                dc += x.realp[0]*h.realp[0];
+                nyq += x.imagp[0]*h.imagp[0];
+                first = 0;
+            }
+            if (failed) break;
+
+            /* an output no input reaches is silent */
+            if (first) {
+                memset(outputs[o], 0, sizeof(float)*out_length);
+                continue;
+            }
+
+            acc.realp[0] = dc;
+            acc.imagp[0] = nyq;
+
+            /* forward (x2) times forward (x2), then the inverse (xn) */
+            fft_vsmul(sum, 0.25f/(float)n, n);
+            if ((failed = fft_dft_execute_inverse_scrambled(inverse, &acc, out_length))) break;
+            fft_ztoc(&acc, outputs[o], out_length);
+        }
+    }
+
+    free(spectra);
+    fft_cache_release(inverse);
+    fft_cache_release(forward);
+    return failed;
+}
+
+/* the split re/im halves of a spectrum of length n stored at `data` */
+static void conv_matrix_spectrum(float* data, long n, t_fft_split* spectrum) {
+    spectrum->realp = data;
+    spectrum->imagp = data + n/2;
+}
+
+/* zero-padded, scrambled spectrum of `length` samples */
+static short conv_matrix_transform(const t_fft_dft_setup* forward, const float* samples, long length, float* data, long n) {
+    t_fft_split spectrum;
+
+    conv_matrix_spectrum(data, n, &spectrum);
+    memset(data, 0, sizeof(float)*n);
+    fft_ctoz(samples, &spectrum, length);
+    return fft_dft_execute_scrambled(forward, &spectrum, length);
+}
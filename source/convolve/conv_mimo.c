@@ -0,0 +1,292 @@
+/**
+    @file conv_mimo - partitioned convolution matrices with shared delay lines
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    the streaming counterpart of conv_matrix.c, for M inputs and N outputs with an impulse response
+    on every path between them (a 16-channel ambisonic signal decoded to binaural, say, takes 32).
+    it works like conv_ols.c, except that what conv_ols keeps per engine is kept per input or per
+    output here:
+
+        per input       the previous block, and the frequency-domain delay line of its last P
+                        block spectra (one forward transform per block)
+        per path        the P partition spectra of its impulse response
+        per output      the sum of products over every input and partition, accumulated as a
+                        spectrum (one inverse transform per block)
+
+    so every input is transformed once per block however many outputs it feeds, and every output
+    is transformed back once however many inputs it sums. M*N separate conv_ols engines would take
+    M*N forward and M*N inverse transforms per block instead of M and N.
+*/
+
+#include "conv.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CONV_MIMO_COST_MAC 2.0      // cost per bin of a complex multiply-add (as in conv_ols.c)
+
+struct _conv_mimo {
+    long                block;      // partition length B (the transforms are 2B long)
+    long                partitions; // P
+    long                inputs;     // M
+    long                outputs;    // N
+    long                head;       // delay line slot of the newest block (the same for every input)
+    t_fft_dft_setup*    forward;
+    t_fft_dft_setup*    inverse;
+    float**             kernels;    // per path (input-major): P partition spectra, or NULL without a path
+    float*              fdl;        // per input: the spectra of its last P blocks
+    float*              history;    // per input: its previous block
+    float*              work;       // per output: the accumulated spectrum
+    float*              bins;       // per output: the accumulated dc and nyquist bins
+    short*              started;    // per output: whether any path has reached it yet this block
+    float*              staging;    // `conv_mimo_run`: padded input and partial output blocks
+};
+
+static void conv_mimo_spectrum(const t_conv_mimo* mimo, float* data, t_fft_split* spectrum);
+
+/**
+ @method `conv_mimo_new`
+ transform the partitions of every impulse response in the matrix
+
+ - Parameters:
+    - irs: the inputs*outputs impulse responses, the one from input i to output o at
+      irs[i*outputs + o] (NULL where there is no path)
+    - ir_length: their length (at least 1)
+    - inputs: number of inputs (M, at most CONV_MIMO_MAX_CHANNELS)
+    - outputs: number of outputs (N, likewise)
+    - block: partition length, rounded up to an even number (`conv_ols_block_size` picks a good one)
+ - Returns: the engine, or NULL if memory ran out
+*/
+t_conv_mimo* conv_mimo_new(const float* const* irs, long ir_length, long inputs, long outputs, long block) {
+    t_conv_mimo* mimo;
+    long size;
+
+    if (ir_length < 1 || block < 1 || inputs < 1 || outputs < 1) return NULL;
+    if (inputs > CONV_MIMO_MAX_CHANNELS || outputs > CONV_MIMO_MAX_CHANNELS) return NULL;
+
+    mimo = (t_conv_mimo*)calloc(1, sizeof(t_conv_mimo));
+    if (!mimo) return NULL;
+
+    mimo->block = block = (block + 1)/2*2;
+    mimo->partitions = (ir_length + block - 1)/block;
+    mimo->inputs = inputs;
+    mimo->outputs = outputs;
+    size = 2*block*mimo->partitions;
+
+    mimo->forward = fft_cache_acquire(2*block, FFT_FORWARD);
+    mimo->inverse = fft_cache_acquire(2*block, FFT_INVERSE);
+    mimo->kernels = (float**)calloc(inputs*outputs, sizeof(float*));
+    mimo->fdl = (float*)malloc(sizeof(float)*size*inputs);
+    mimo->history = (float*)malloc(sizeof(float)*block*inputs);
+    mimo->work = (float*)malloc(sizeof(float)*2*block*outputs);
+    mimo->bins = (float*)malloc(sizeof(float)*2*outputs);
+    mimo->started = (short*)malloc(sizeof(short)*outputs);
+    mimo->staging = (float*)malloc(sizeof(float)*block*(inputs + outputs));
+
+    if (!mimo->forward || !mimo->inverse || !mimo->kernels || !mimo->fdl || !mimo->history || !mimo->work || !mimo->bins ||
+        !mimo->started || !mimo->staging) {
+        conv_mimo_free(mimo);
+        return NULL;
+    }
+
+    /* forward (x2) times forward (x2), then the inverse (x2B): fold 1/8B into the kernels */
+    for (long k = 0; k < inputs*outputs; k++) {
+        if (!irs[k]) continue;
+
+        mimo->kernels[k] = (float*)malloc(sizeof(float)*size);
+        if (!mimo->kernels[k]) {
+            conv_mimo_free(mimo);
+            return NULL;
+        }
+
+        for (long p = 0; p < mimo->partitions; p++) {
+            long count = ir_length - p*block < block ? ir_length - p*block : block;
+            t_fft_split h;
+
+            conv_mimo_spectrum(mimo, mimo->kernels[k] + 2*block*p, &h);
+            memset(h.realp, 0, sizeof(float)*block);
+            memset(h.imagp, 0, sizeof(float)*block);
+            fft_ctoz(irs[k] + p*block, &h, count);
+            if (fft_dft_execute_scrambled(mimo->forward, &h, count)) {
+                conv_mimo_free(mimo);
+                return NULL;
+            }
+            fft_vsmul(h.realp, 0.125f/(float)block, block);
+            fft_vsmul(h.imagp, 0.125f/(float)block, block);
+        }
+    }
+
+    conv_mimo_reset(mimo);
+    return mimo;
+}
+
+void conv_mimo_free(t_conv_mimo* mimo) {
+    if (!mimo) return;
+
+    for (long k = 0; mimo->kernels && k < mimo->inputs*mimo->outputs; k++) free(mimo->kernels[k]);
+    fft_cache_release(mimo->inverse);
+    fft_cache_release(mimo->forward);
+    free(mimo->kernels);
+    free(mimo->fdl);
+    free(mimo->history);
+    free(mimo->work);
+    free(mimo->bins);
+    free(mimo->started);
+    free(mimo->staging);
+    free(mimo);
+}
+
+long conv_mimo_block(const t_conv_mimo* mimo) {
+    return mimo ? mimo->block : 0;
+}
+
+/* forget the signals so far (as if they had been silent) */
+void conv_mimo_reset(t_conv_mimo* mimo) {
+    memset(mimo->fdl, 0, sizeof(float)*2*mimo->block*mimo->partitions*mimo->inputs);
+    memset(mimo->history, 0, sizeof(float)*mimo->block*mimo->inputs);
+    mimo->head = 0;
+}
+
+/**
+ @method `conv_mimo_process`
+ convolve the next block of every input
+
+ - Parameters:
+    - mimo: the engine
+    - in: the next `conv_mimo_block` samples of each input
+    - out: the matching `conv_mimo_block` samples of each output (must not alias the inputs)
+*/
+void conv_mimo_process(t_conv_mimo* mimo, const float* const* in, float* const* out) {
+    long block = mimo->block;
+    long half = block/2;
+    long line = 2*block*mimo->partitions;   // floats per input's delay line
+    t_fft_split x, acc, packed;
+
+    /* the delay line slot of the oldest block gets the newest one, for every input */
+    mimo->head = (mimo->head + 1) % mimo->partitions;
+
+    for (long i = 0; i < mimo->inputs; i++) {
+        float* history = mimo->history + block*i;
+
+        /* [new, previous] (see the top of conv_ols.c) */
+        conv_mimo_spectrum(mimo, mimo->fdl + line*i + 2*block*mimo->head, &x);
+        fft_ctoz(in[i], &x, block);
+        packed.realp = x.realp + half;
+        packed.imagp = x.imagp + half;
+        fft_ctoz(history, &packed, block);
+        memcpy(history, in[i], sizeof(float)*block);
+
+        fft_dft_execute_scrambled(mimo->forward, &x, 2*block);
+    }
+
+    /* every output sums its paths over the shared delay lines, into its own accumulator. inputs
+       and partitions go on the outside so each spectrum of the delay lines is read once per block,
+       whatever the number of outputs. bin 0 packs the real dc and nyquist bins, which are
+       multiplied separately */
+    memset(mimo->bins, 0, sizeof(float)*2*mimo->outputs);
+    memset(mimo->started, 0, sizeof(short)*mimo->outputs);
+
+    for (long i = 0; i < mimo->inputs; i++) {
+        for (long p = 0; p < mimo->partitions; p++) {
+            long slot = (mimo->head - p + mimo->partitions) % mimo->partitions;
+
+            conv_mimo_spectrum(mimo, mimo->fdl + line*i + 2*block*slot, &x);
+
+            for (long o = 0; o < mimo->outputs; o++) {
+                const float* kernel = mimo->kernels[i*mimo->outputs + o];
+                t_fft_split h;
+
+                if (!kernel) continue;
+                conv_mimo_spectrum(mimo, (float*)kernel + 2*block*p, &h);
+                conv_mimo_spectrum(mimo, mimo->work + 2*block*o, &acc);
+
+                if (mimo->started[o]) fft_zvma(&x, &h, &acc, &acc, block);
+                else fft_zvmul(&x, &h, &acc, block);
+                mimo->started[o] = 1;
+
+                mimo->bins[2*o] += x.realp[0]*h.realp[0];
+                mimo->bins[2*o + 1] += x.imagp[0]*h.imagp[0];
+            }
+        }
+    }
+
+    for (long o = 0; o < mimo->outputs; o++) {
+        /* an output no input reaches is silent */
+        if (!mimo->started[o]) {
+            memset(out[o], 0, sizeof(float)*block);
+            continue;
+        }
+
+        conv_mimo_spectrum(mimo, mimo->work + 2*block*o, &acc);
+        acc.realp[0] = mimo->bins[2*o];
+        acc.imagp[0] = mimo->bins[2*o + 1];
+        fft_dft_execute_inverse_scrambled(mimo->inverse, &acc, block);
+        fft_ztoc(&acc, out[o], block);
+    }
+}
+
+/**
+ @method `conv_mimo_run`
+ offline convolution of whole signals, starting from silence (see `conv_ols_run`)
+
+ - Parameters:
+    - mimo: the engine (it is reset first)
+    - in: every input, each `in_length` samples long
+    - in_length: their length
+    - out: where to write every output
+    - out_length: number of samples to compute per output (in_length + ir_length - 1 for all of them)
+*/
+void conv_mimo_run(t_conv_mimo* mimo, const float* const* in, long in_length, float* const* out, long out_length) {
+    long block = mimo->block;
+    long inputs = mimo->inputs;
+    long outputs = mimo->outputs;
+    const float* src[CONV_MIMO_MAX_CHANNELS];
+    float* dst[CONV_MIMO_MAX_CHANNELS];
+
+    conv_mimo_reset(mimo);
+
+    for (long start = 0; start < out_length; start += block) {
+        short partial = start + block > out_length;
+
+        /* the last blocks run past the end of the signals */
+        for (long i = 0; i < inputs; i++) {
+            if (start + block > in_length) {
+                float* padded = mimo->staging + block*i;
+                long count = in_length > start ? in_length - start : 0;
+
+                if (count) memcpy(padded, in[i] + start, sizeof(float)*count);
+                memset(padded + count, 0, sizeof(float)*(block - count));
+                src[i] = padded;
+            } else {
+                src[i] = in[i] + start;
+            }
+        }
+
+        for (long o = 0; o < outputs; o++) {
+            dst[o] = partial ? mimo->staging + block*(inputs + o) : out[o] + start;
+        }
+
+        conv_mimo_process(mimo, src, dst);
+
+        for (long o = 0; partial && o < outputs; o++) {
+            memcpy(out[o] + start, dst[o], sizeof(float)*(out_length - start));
+        }
+    }
+}
+
+/**
+ @method `conv_mimo_cost`
+ estimated cost per output frame of `conv_mimo_process` with every path present, on the scale of
+ `fft_cost` (see `conv_ols_cost`)
+*/
+double conv_mimo_cost(long ir_length, long block, long inputs, long outputs) {
+    long partitions = (ir_length + block - 1)/block;
+    return ((double)(inputs + outputs)*fft_cost(2*block)
+            + CONV_MIMO_COST_MAC*(double)(partitions*block)*(double)(inputs*outputs))/(double)block;
+}
+
+/* the split re/im halves of a spectrum stored at `data` */
+static void conv_mimo_spectrum(const t_conv_mimo* mimo, float* data, t_fft_split* spectrum) {
+    spectrum->realp = data;
+    spectrum->imagp = data + mimo->block;
+}
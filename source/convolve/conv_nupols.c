@@ -0,0 +1,249 @@
+/**
+    @file conv_nupols - non-uniformly partitioned overlap-save convolution
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    a uniform partition length is a trade-off: the latency is one partition, but a long impulse
+    response cut into short partitions costs a spectrum product per partition per block. here the
+    head of the impulse response uses short partitions and the tail longer and longer ones (after
+    Gardner and Garcia), so the latency is that of the shortest partition and the cost close to
+    that of the longest.
+
+    the impulse response is split into segments, each a uniformly partitioned engine (conv_ols.c)
+    over its own slice of the response:
+
+        segment     0       1       2       3       ...
+        partition   B       2B      4B      8B      ... up to the largest size, which takes the rest
+        slice       2B      4B      8B      16B     (two partitions of each size)
+
+    a segment with partitions of B_i samples only has its output for a block of input once that
+    whole block has arrived, B_i - B samples after the block started. so it may only start
+    that far into the response, which two partitions per size always satisfy: segment i starts at
+    2B(2^i - 1) >= B_i - B. its output is added into a ring of future output, and every call hands
+    out the next B samples of that ring.
+
+    every segment whose block ends with a call runs in that call, so calls where the long segments
+    run take longer than the others. that's fine offline; a real-time host would want to move the
+    long segments to a background thread.
+*/
+
+#include "conv.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CONV_NUPOLS_MAX_SEGMENTS 32
+
+typedef struct _conv_segment {
+    t_conv_ols* ols;
+    long        offset;     // where its slice of the impulse response starts
+    long        block;      // its partition length
+    float*      input;      // input collected since its last block (segments after the first)
+} t_conv_segment;
+
+struct _conv_nupols {
+    long            block;      // samples per call (the first segment's partition length)
+    long            count;      // number of segments
+    t_conv_segment  segments[CONV_NUPOLS_MAX_SEGMENTS];
+    long            time;       // samples processed since the last reset
+    float*          ring;       // future output, indexed by time modulo `ring_length`
+    long            ring_length;
+    float*          work;       // one segment's output block
+    float*          staging;    // `conv_nupols_run`: padded input and partial output blocks
+};
+
+static long conv_nupols_plan(long ir_length, long block, long max_block, long* offsets, long* blocks);
+
+/**
+ @method `conv_nupols_new`
+ split an impulse response into segments of growing partition length and transform them
+
+ - Parameters:
+    - ir: impulse response
+    - ir_length: its length (at least 1)
+    - block: the shortest partition, which is also the number of samples per call (rounded up to
+      an even number)
+    - max_block: the longest partition (rounded down to block times a power of two), or 0 to use
+      `conv_ols_block_size`
+ - Returns: the engine, or NULL if memory ran out
+*/
+t_conv_nupols* conv_nupols_new(const float* ir, long ir_length, long block, long max_block) {
+    t_conv_nupols* nu;
+    long offsets[CONV_NUPOLS_MAX_SEGMENTS];
+    long blocks[CONV_NUPOLS_MAX_SEGMENTS];
+    long largest;
+
+    if (ir_length < 1 || block < 1) return NULL;
+
+    nu = (t_conv_nupols*)calloc(1, sizeof(t_conv_nupols));
+    if (!nu) return NULL;
+
+    nu->block = block = (block + 1)/2*2;
+    nu->count = conv_nupols_plan(ir_length, block, max_block, offsets, blocks);
+    largest = blocks[nu->count - 1];
+
+    /* a segment writes up to its offset + block - 1 ahead of the oldest sample not yet handed out */
+    nu->ring_length = offsets[nu->count - 1] + largest + block;
+    nu->ring = (float*)malloc(sizeof(float)*nu->ring_length);
+    nu->work = (float*)malloc(sizeof(float)*largest);
+    nu->staging = (float*)malloc(sizeof(float)*2*block);
+
+    if (!nu->ring || !nu->work || !nu->staging) {
+        conv_nupols_free(nu);
+        return NULL;
+    }
+
+    for (long i = 0; i < nu->count; i++) {
+        t_conv_segment* s = nu->segments + i;
+        long end = i + 1 < nu->count ? offsets[i + 1] : ir_length;
+
+        s->offset = offsets[i];
+        s->block = blocks[i];
+        s->ols = conv_ols_new(ir + s->offset, end - s->offset, s->block);
+
+        if (!s->ols || (i && !(s->input = (float*)malloc(sizeof(float)*s->block)))) {
+            conv_nupols_free(nu);
+            return NULL;
+        }
+    }
+
+    conv_nupols_reset(nu);
+    return nu;
+}
+
+void conv_nupols_free(t_conv_nupols* nu) {
+    if (!nu) return;
+
+    for (long i = 0; i < nu->count; i++) {
+        conv_ols_free(nu->segments[i].ols);
+        free(nu->segments[i].input);
+    }
+    free(nu->ring);
+    free(nu->work);
+    free(nu->staging);
+    free(nu);
+}
+
+long conv_nupols_block(const t_conv_nupols* nu) {
+    return nu ? nu->block : 0;
+}
+
+/* forget the signal so far (as if it had been silent) */
+void conv_nupols_reset(t_conv_nupols* nu) {
+    for (long i = 0; i < nu->count; i++) conv_ols_reset(nu->segments[i].ols);
+    memset(nu->ring, 0, sizeof(float)*nu->ring_length);
+    nu->time = 0;
+}
+
+/**
+ @method `conv_nupols_process`
+ convolve the next block of the signal (see `conv_ols_process`)
+
+ - Parameters:
+    - nu: the engine
+    - in: the next `conv_nupols_block` samples of the signal
+    - out: the matching `conv_nupols_block` samples of the convolution (may alias `in`)
+*/
+void conv_nupols_process(t_conv_nupols* nu, const float* in, float* out) {
+    long block = nu->block;
+    long now = nu->time % nu->ring_length;
+
+    for (long i = 0; i < nu->count; i++) {
+        t_conv_segment* s = nu->segments + i;
+        long filled = nu->time % s->block + block;  // samples of its current block, counting this call's
+        long start = nu->time + block - filled;     // time its current block started
+        const float* src = in;
+
+        if (i) {
+            memcpy(s->input + filled - block, in, sizeof(float)*block);
+            if (filled < s->block) continue;
+            src = s->input;
+        }
+
+        conv_ols_process(s->ols, src, nu->work);
+
+        /* accumulate into the ring from start + offset on, wrapping around its end */
+        for (long j = 0, r = (start + s->offset) % nu->ring_length; j < s->block; j++) {
+            nu->ring[r] += nu->work[j];
+            if (++r == nu->ring_length) r = 0;
+        }
+    }
+
+    /* hand out the next block (the ring length is a multiple of it, so it never wraps) */
+    memcpy(out, nu->ring + now, sizeof(float)*block);
+    memset(nu->ring + now, 0, sizeof(float)*block);
+    nu->time += block;
+}
+
+/**
+ @method `conv_nupols_run`
+ offline convolution of a whole signal, starting from silence (see `conv_ols_run`)
+*/
+void conv_nupols_run(t_conv_nupols* nu, const float* in, long in_length, float* out, long out_length) {
+    long block = nu->block;
+    float* padded = nu->staging;
+    float* partial = nu->staging + block;
+
+    conv_nupols_reset(nu);
+
+    for (long start = 0; start < out_length; start += block) {
+        const float* src = start < in_length ? in + start : padded;
+        float* dst = start + block <= out_length ? out + start : partial;
+
+        if (start + block > in_length) {
+            long count = in_length > start ? in_length - start : 0;
+            if (count) memcpy(padded, in + start, sizeof(float)*count);
+            memset(padded + count, 0, sizeof(float)*(block - count));
+            src = padded;
+        }
+
+        conv_nupols_process(nu, src, dst);
+        if (dst == partial) memcpy(out + start, partial, sizeof(float)*(out_length - start));
+    }
+}
+
+/**
+ @method `conv_nupols_cost`
+ estimated cost per output sample of `conv_nupols_process` (on the scale of `fft_cost`), for the
+ same arguments as `conv_nupols_new`
+*/
+double conv_nupols_cost(long ir_length, long block, long max_block) {
+    long offsets[CONV_NUPOLS_MAX_SEGMENTS];
+    long blocks[CONV_NUPOLS_MAX_SEGMENTS];
+    long count;
+    double cost = 0.;
+
+    block = (block + 1)/2*2;
+    count = conv_nupols_plan(ir_length, block, max_block, offsets, blocks);
+
+    for (long i = 0; i < count; i++) {
+        long end = i + 1 < count ? offsets[i + 1] : ir_length;
+        cost += conv_ols_cost(end - offsets[i], blocks[i]);
+    }
+
+    return cost;
+}
+
+/* the segments: two partitions per size, doubling up to max_block, which takes the rest.
+   returns the number of segments */
+static long conv_nupols_plan(long ir_length, long block, long max_block, long* offsets, long* blocks) {
+    long count = 0;
+    long offset = 0;
+    long size = block;
+
+    if (max_block < 1) max_block = conv_ols_block_size(ir_length);
+
+    /* the ring is indexed in whole calls, so every size is block times a power of two */
+    while (offset < ir_length && count < CONV_NUPOLS_MAX_SEGMENTS) {
+        short last = 2*size > max_block || count == CONV_NUPOLS_MAX_SEGMENTS - 1;
+
+        offsets[count] = offset;
+        blocks[count] = size;
+        count++;
+
+        if (last) break;
+        offset += 2*size;
+        size *= 2;
+    }
+
+    return count;
+}
@@ -0,0 +1,387 @@
+/**
+    @file conv_ols - uniformly partitioned overlap-save convolution
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    the impulse response is cut into P partitions of B samples, and each is transformed once (zero
+    padded to 2B). the signal then goes through B samples at a time: every block is transformed
+    once into a frequency-domain delay line that holds the spectra of the last P blocks, and block
+    k of the output is
+
+        y_k = sum over p of (x_{k-p} * h_p), the last B samples of each circular convolution
+
+    so it costs one forward and one inverse transform of length 2B plus P spectrum products per
+    block, and memory for 2P spectra, however long the signal is.
+
+    two details keep the transforms cheap:
+    - each block is transformed as [new B samples, previous B samples] rather than the other way
+      around. that rotates every circular convolution by B, so the valid output is the *first* B
+      samples, which is what the pruned inverse computes.
+    - the spectra are only ever multiplied and summed, so they stay in whatever bin order the
+      forward transform leaves them in (see `fft_dft_execute_scrambled`).
+*/
+
+#include "conv.h"
+#include "fft_private.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CONV_OLS_MIN_BLOCK 64       // smallest partition `conv_ols_block_size` considers
+#define CONV_COST_MAC 2.0           // cost per bin of a complex multiply-add (the fft_cost scale)
+#define CONV_OLS_CHUNKS 8           // chunks per worker in `conv_ols_run_parallel`, for balance
+#define CONV_OLS_CHUNK_WARMUP 4     // ...but at least this many partitions' worth of blocks each
+
+struct _conv_ols {
+    long                block;      // partition length B (the transforms are 2B long)
+    long                partitions; // P
+    long                head;       // delay line slot of the newest block
+    t_fft_dft_setup*    forward;
+    t_fft_dft_setup*    inverse;
+    float*              kernel;     // P partition spectra of B complex values (split re/im, scrambled order)
+    short               shared;     // the kernel belongs to the engine this one was cloned from
+    float*              fdl;        // the delay line: spectra of the last P blocks, same layout
+    float*              history;    // the previous block of input
+    float*              work;       // the accumulated spectrum, then the output block
+    float*              staging;    // `conv_ols_run`: padded input and partial output blocks
+    long                position;   // `conv_ols_run`: the next block of the signal it expects
+};
+
+/* one `conv_ols_run_parallel` call, split between the workers */
+typedef struct _conv_ols_chunks {
+    t_conv_ols*     ols;
+    const float*    in;
+    long            in_length;
+    float*          out;
+    long            out_length;
+    long            blocks;     // of output
+    long            chunk;      // blocks per chunk
+    t_fft_counter   next;       // the next chunk nobody has taken yet
+    long            orphans[FFT_MAX_WORKERS];   // per worker: a chunk it took but had no engine for, or -1
+} t_conv_ols_chunks;
+
+static t_conv_ols* conv_ols_alloc(long block, long partitions, short shared);
+static void conv_ols_spectrum(const t_conv_ols* ols, float* data, t_fft_split* spectrum);
+static void conv_ols_push(t_conv_ols* ols, const float* in);
+static const float* conv_ols_input(t_conv_ols* ols, const float* in, long in_length, long index);
+static void conv_ols_run_blocks(t_conv_ols* ols, const float* in, long in_length, float* out, long out_length, long first, long last);
+static void conv_ols_chunk_job(void* data, long index, long count);
+
+/**
+ @method `conv_ols_new`
+ transform the partitions of an impulse response
+
+ - Parameters:
+    - ir: impulse response
+    - ir_length: its length (at least 1)
+    - block: partition length; rounded up to an even number. `conv_ols_block_size` picks a good one.
+ - Returns: the engine, or NULL if memory ran out
+*/
+t_conv_ols* conv_ols_new(const float* ir, long ir_length, long block) {
+    t_conv_ols* ols;
+
+    if (ir_length < 1 || block < 1) return NULL;
+
+    block = (block + 1)/2*2;
+    ols = conv_ols_alloc(block, (ir_length + block - 1)/block, 0);
+    if (!ols) return NULL;
+
+    /* forward (x2) times forward (x2), then the inverse (x2B): fold 1/8B into the kernel */
+    for (long p = 0; p < ols->partitions; p++) {
+        long count = ir_length - p*block < block ? ir_length - p*block : block;
+        t_fft_split h;
+
+        conv_ols_spectrum(ols, ols->kernel + 2*block*p, &h);
+        memset(h.realp, 0, sizeof(float)*block);
+        memset(h.imagp, 0, sizeof(float)*block);
+        fft_ctoz(ir + p*block, &h, count);
+        if (fft_dft_execute_scrambled(ols->forward, &h, count)) {
+            conv_ols_free(ols);
+            return NULL;
+        }
+        fft_vsmul(h.realp, 0.125f/(float)block, block);
+        fft_vsmul(h.imagp, 0.125f/(float)block, block);
+    }
+
+    conv_ols_reset(ols);
+    return ols;
+}
+
+/**
+ @method `conv_ols_clone`
+ another engine on the same partitioned impulse response, with a delay line of its own: for
+ convolving several signals with one response at the same time without transforming it again.
+ the response still belongs to `ols`, which must outlive its clones.
+
+ - Returns: the engine (reset), or NULL if memory ran out
+*/
+t_conv_ols* conv_ols_clone(const t_conv_ols* ols) {
+    t_conv_ols* clone = conv_ols_alloc(ols->block, ols->partitions, 1);
+
+    if (!clone) return NULL;
+
+    clone->kernel = ols->kernel;
+    conv_ols_reset(clone);
+    return clone;
+}
+
+void conv_ols_free(t_conv_ols* ols) {
+    if (!ols) return;
+
+    fft_cache_release(ols->inverse);
+    fft_cache_release(ols->forward);
+    if (!ols->shared) free(ols->kernel);
+    free(ols->fdl);
+    free(ols->history);
+    free(ols->work);
+    free(ols->staging);
+    free(ols);
+}
+
+long conv_ols_block(const t_conv_ols* ols) {
+    return ols ? ols->block : 0;
+}
+
+/* forget the signal so far (as if it had been silent) */
+void conv_ols_reset(t_conv_ols* ols) {
+    memset(ols->fdl, 0, sizeof(float)*2*ols->block*ols->partitions);
+    memset(ols->history, 0, sizeof(float)*ols->block);
+    ols->head = 0;
+    ols->position = 0;
+}
+
+/**
+ @method `conv_ols_process`
+ convolve the next block of the signal
+
+ - Parameters:
+    - ols: the engine
+    - in: the next `conv_ols_block` samples of the signal
+    - out: the matching `conv_ols_block` samples of the convolution (may alias `in`)
+*/
+void conv_ols_process(t_conv_ols* ols, const float* in, float* out) {
+    long block = ols->block;
+    t_fft_split x, acc;
+    float dc = 0.f, nyq = 0.f;
+
+    conv_ols_push(ols, in);
+
+    /* sum of products over the delay line. bin 0 packs the real dc and nyquist bins, which are
+       multiplied separately */
+    conv_ols_spectrum(ols, ols->work, &acc);
+    for (long p = 0; p < ols->partitions; p++) {
+        long slot = (ols->head - p + ols->partitions) % ols->partitions;
+        t_fft_split h;
+
+        conv_ols_spectrum(ols, ols->fdl + 2*block*slot, &x);
+        conv_ols_spectrum(ols, ols->kernel + 2*block*p, &h);
+
+        if (p) fft_zvma(&x, &h, &acc, &acc, block);
+        else fft_zvmul(&x, &h, &acc, block);
+
+        dc += x.realp[0]*h.realp[0];
+        nyq += x.imagp[0]*h.imagp[0];
+    }
+    acc.realp[0] = dc;
+    acc.imagp[0] = nyq;
+
+    fft_dft_execute_inverse_scrambled(ols->inverse, &acc, block);
+    fft_ztoc(&acc, out, block);
+}
+
+/**
+ @method `conv_ols_run`
+ offline convolution of a whole signal, starting from silence
+
+ - Parameters:
+    - ols: the engine (it is reset first)
+    - in: the signal
+    - in_length: its length
+    - out: where to write the convolution
+    - out_length: number of samples to compute (in_length + ir_length - 1 for all of them)
+*/
+void conv_ols_run(t_conv_ols* ols, const float* in, long in_length, float* out, long out_length) {
+    conv_ols_reset(ols);
+    conv_ols_run_blocks(ols, in, in_length, out, out_length, 0, (out_length + ols->block - 1)/ols->block);
+}
+
+/**
+ @method `conv_ols_run_parallel`
+ `conv_ols_run` on every worker (see `fft_parallel_run`). once the partitions are transformed, the
+ output blocks only depend on the signal, so the output is cut into chunks of blocks that the
+ workers take in turn until none are left, each with an engine of its own (a clone, for all but
+ the first). a chunk is written straight into `out`, and an engine picks the signal up at the start
+ of its chunk by transforming the P - 1 blocks before it into its delay line, unless it has just
+ finished the chunk before. the result is the same as `conv_ols_run`'s.
+
+ - Parameters: same as `conv_ols_run`
+*/
+void conv_ols_run_parallel(t_conv_ols* ols, const float* in, long in_length, float* out, long out_length) {
+    long workers = fft_parallel_workers();
+    long blocks = (out_length + ols->block - 1)/ols->block;
+    long chunk = (blocks + CONV_OLS_CHUNKS*workers - 1)/(CONV_OLS_CHUNKS*workers);
+    long count;
+
+    if (chunk < CONV_OLS_CHUNK_WARMUP*ols->partitions) chunk = CONV_OLS_CHUNK_WARMUP*ols->partitions;
+    count = (blocks + chunk - 1)/chunk;
+
+    t_conv_ols_chunks chunks = {ols, in, in_length, out, out_length, blocks, chunk, 0, {0}};
+    for (long i = 0; i < FFT_MAX_WORKERS; i++) chunks.orphans[i] = -1;
+
+    conv_ols_reset(ols);
+    fft_parallel_run(conv_ols_chunk_job, &chunks, count < workers ? count : workers);
+
+    /* chunks left behind by workers that ran out of memory */
+    for (long i = 0; i < FFT_MAX_WORKERS; i++) {
+        long first = chunks.orphans[i]*chunks.chunk;
+        long last = first + chunks.chunk < chunks.blocks ? first + chunks.chunk : chunks.blocks;
+
+        if (chunks.orphans[i] >= 0) conv_ols_run_blocks(ols, in, in_length, out, out_length, first, last);
+    }
+}
+
+/**
+ @method `conv_ols_cost`
+ estimated cost per output sample of `conv_ols_process` with an impulse response of `ir_length`
+ and partitions of `block` samples, on the scale of `fft_cost`
+*/
+double conv_ols_cost(long ir_length, long block) {
+    long partitions = (ir_length + block - 1)/block;
+    return (2.0*fft_cost(2*block) + CONV_COST_MAC*(double)(partitions*block))/(double)block;
+}
+
+/**
+ @method `conv_ols_block_size`
+ - Returns: the power-of-two partition length with the lowest `conv_ols_cost` for an offline
+   convolution with an impulse response of `ir_length` (no longer than the next power of two up)
+*/
+long conv_ols_block_size(long ir_length) {
+    long best = CONV_OLS_MIN_BLOCK;
+    double best_cost = conv_ols_cost(ir_length, best);
+
+    for (long block = 2*CONV_OLS_MIN_BLOCK; block/2 < ir_length; block *= 2) {
+        double cost = conv_ols_cost(ir_length, block);
+        if (cost < best_cost) {
+            best = block;
+            best_cost = cost;
+        }
+    }
+
+    return best;
+}
+
+/* an engine with room for everything but (if `shared`) the kernel, or NULL if memory ran out */
+static t_conv_ols* conv_ols_alloc(long block, long partitions, short shared) {
+    t_conv_ols* ols = (t_conv_ols*)calloc(1, sizeof(t_conv_ols));
+    long size = 2*block*partitions;
+
+    if (!ols) return NULL;
+
+    ols->block = block;
+    ols->partitions = partitions;
+    ols->shared = shared;
+
+    ols->forward = fft_cache_acquire(2*block, FFT_FORWARD);
+    ols->inverse = fft_cache_acquire(2*block, FFT_INVERSE);
+    if (!shared) ols->kernel = (float*)malloc(sizeof(float)*size);
+    ols->fdl = (float*)malloc(sizeof(float)*size);
+    ols->history = (float*)malloc(sizeof(float)*block);
+    ols->work = (float*)malloc(sizeof(float)*2*block);
+    ols->staging = (float*)malloc(sizeof(float)*2*block);
+
+    if (!ols->forward || !ols->inverse || (!shared && !ols->kernel) || !ols->fdl || !ols->history || !ols->work || !ols->staging) {
+        conv_ols_free(ols);
+        return NULL;
+    }
+
+    return ols;
+}
+
+/* the next block of the signal into the delay line, without computing any output */
+static void conv_ols_push(t_conv_ols* ols, const float* in) {
+    long block = ols->block;
+    long half = block/2;
+    t_fft_split x, packed;
+
+    /* the delay line slot of the oldest block gets the newest one */
+    ols->head = (ols->head + 1) % ols->partitions;
+    conv_ols_spectrum(ols, ols->fdl + 2*block*ols->head, &x);
+
+    /* [new, previous] (see the top of this file) */
+    fft_ctoz(in, &x, block);
+    packed.realp = x.realp + half;
+    packed.imagp = x.imagp + half;
+    fft_ctoz(ols->history, &packed, block);
+    memcpy(ols->history, in, sizeof(float)*block);
+
+    fft_dft_execute_scrambled(ols->forward, &x, 2*block);
+}
+
+/* block `index` of the signal, zero-padded into the staging area where it runs past the end */
+static const float* conv_ols_input(t_conv_ols* ols, const float* in, long in_length, long index) {
+    long block = ols->block;
+    long start = index*block;
+    long count = in_length > start ? in_length - start : 0;
+
+    if (count >= block) return in + start;
+
+    if (count) memcpy(ols->staging, in + start, sizeof(float)*count);
+    memset(ols->staging + count, 0, sizeof(float)*(block - count));
+    return ols->staging;
+}
+
+/* output blocks [first, last) of `conv_ols_run`, picking the signal up at `first` if the engine
+   isn't already there */
+static void conv_ols_run_blocks(t_conv_ols* ols, const float* in, long in_length, float* out, long out_length, long first, long last) {
+    long block = ols->block;
+    float* partial = ols->staging + block;
+
+    if (ols->position != first) {
+        long warmup = first - ols->partitions + 1 > 0 ? first - ols->partitions + 1 : 0;
+
+        /* the block before the delay line's oldest one is only needed as history */
+        conv_ols_reset(ols);
+        if (warmup) memcpy(ols->history, conv_ols_input(ols, in, in_length, warmup - 1), sizeof(float)*block);
+        for (long k = warmup; k < first; k++) conv_ols_push(ols, conv_ols_input(ols, in, in_length, k));
+    }
+
+    for (long k = first; k < last; k++) {
+        long start = k*block;
+        float* dst = start + block <= out_length ? out + start : partial;
+
+        /* the last blocks run past the end of the signal */
+        conv_ols_process(ols, conv_ols_input(ols, in, in_length, k), dst);
+        if (dst == partial) memcpy(out + start, partial, sizeof(float)*(out_length - start));
+    }
+
+    ols->position = last;
+}
+
+/* a worker of `conv_ols_run_parallel`: the next chunk until there are none left (the counter
+   balances the work, so the number of workers doesn't matter) */
+static void conv_ols_chunk_job(void* data, long index, long count) {
+    t_conv_ols_chunks* chunks = (t_conv_ols_chunks*)data;
+    t_conv_ols* ols = index ? NULL : chunks->ols;
+    long chunk;
+
+    (void)count;
+
+    while ((chunk = fft_counter_next(&chunks->next))*chunks->chunk < chunks->blocks) {
+        long first = chunk*chunks->chunk;
+        long last = first + chunks->chunk < chunks->blocks ? first + chunks->chunk : chunks->blocks;
+
+        /* (engines are only cloned once there is work for them) */
+        if (!ols && !(ols = conv_ols_clone(chunks->ols))) {
+            chunks->orphans[index] = chunk;
+            break;
+        }
+        conv_ols_run_blocks(ols, chunks->in, chunks->in_length, chunks->out, chunks->out_length, first, last);
+    }
+
+    if (ols != chunks->ols) conv_ols_free(ols);
+}
+
+/* the split re/im halves of a spectrum stored at `data` */
+static void conv_ols_spectrum(const t_conv_ols* ols, float* data, t_fft_split* spectrum) {
+    spectrum->realp = data;
+    spectrum->imagp = data + ols->block;
+}
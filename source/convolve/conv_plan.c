@@ -0,0 +1,341 @@
+/**
+    @file conv_plan - choosing the cheapest convolution method for a job
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    every method has a cost model in abstract units (the scale of `fft_cost`, or multiply-adds for
+    the direct method):
+
+        direct      one multiply-add per output sample and tap
+        fft         one transform for the impulse response, then a forward and a pruned inverse
+                    transform of the whole result per channel
+        ols         per output sample, `conv_ols_cost` with the best partition the latency allows
+        nupols      likewise with `conv_nupols_cost`, the first partition at most the latency
+
+    a unit of the FFT-based methods doesn't take the same time at every size: once a transform
+    outgrows the caches, each of its passes is a trip through main memory. the calibration table
+    therefore holds the seconds per unit measured for transforms of every other power of two (and
+    interpolates in between), plus the seconds per tap of the direct method. the defaults were
+    measured on an AVX2 machine; `conv_calibrate` measures them on this one, and they're saved with
+    the FFT wisdom (lines starting with "conv", which `fft_wisdom_import` skips).
+
+    a latency of 0 means offline: the whole signal is there, and only the run time matters. any
+    other latency rules out the single transform, and limits the partitions to that many samples.
+*/
+
+#include "conv.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CONV_PLAN_MIN_BLOCK 16          // shortest partition worth transforming
+#define CONV_PLAN_MIN_LOG2N 6           // transform lengths in the calibration table: 2^6, 2^8, ... 2^22
+#define CONV_PLAN_MAX_LOG2N 22
+#define CONV_PLAN_SIZES ((CONV_PLAN_MAX_LOG2N - CONV_PLAN_MIN_LOG2N)/2 + 1)
+#define CONV_COST_PACK 2.0              // cost per sample of packing and unpacking (the fft_cost scale)
+#define CONV_CALIBRATE_SECONDS 0.02     // minimum timing run per measurement
+
+static const char* const conv_method_names[CONV_METHOD_COUNT] = { "direct", "fft", "ols", "nupols" };
+
+/* seconds per `fft_cost` unit for real transforms of length 2^6, 2^8, ... 2^22 */
+static double conv_plan_fft_seconds[CONV_PLAN_SIZES] = {
+    3.4e-10, 2.6e-10, 2.3e-10, 1.9e-10, 2.4e-10, 3.1e-10, 3.3e-10, 3.2e-10, 3.8e-10
+};
+
+/* seconds per multiply-add of the direct method */
+static double conv_plan_tap_seconds = 4.2e-11;
+
+static double conv_plan_estimate(int method, long signal_length, long ir_length, long channels, long block, long* length);
+static double conv_plan_fft_factor(long n);
+static long conv_plan_block(int method, long ir_length, long latency);
+static double conv_calibrate_fft(long n);
+static double conv_calibrate_direct(void);
+static double conv_calibrate_now(void);
+
+/**
+ @method `conv_plan`
+ pick the method with the lowest estimated run time for a job
+
+ - Parameters:
+    - plan: filled in with the method, its parameters and the estimated time
+    - signal_length: length of the (longer) signal
+    - ir_length: length of the impulse response
+    - channels: number of signals convolved with the same impulse response
+    - latency: largest block the job can wait for, in samples, or 0 for offline jobs
+*/
+void conv_plan(t_conv_plan* plan, long signal_length, long ir_length, long channels, long latency) {
+    if (channels < 1) channels = 1;
+
+    plan->method = CONV_METHOD_DIRECT;
+    plan->block = 0;
+    plan->length = 0;
+    plan->seconds = conv_plan_estimate(CONV_METHOD_DIRECT, signal_length, ir_length, channels, 0, NULL);
+
+    for (int method = CONV_METHOD_FFT; method < CONV_METHOD_COUNT; method++) {
+        long block = conv_plan_block(method, ir_length, latency);
+        long length = 0;
+        double seconds;
+
+        if (method == CONV_METHOD_FFT ? latency > 0 : block < CONV_PLAN_MIN_BLOCK) continue;
+
+        /* offline, a single segment of long partitions always beats starting short */
+        if (method == CONV_METHOD_NUPOLS && latency <= 0) continue;
+
+        seconds = conv_plan_estimate(method, signal_length, ir_length, channels, block, &length);
+        if (seconds < plan->seconds) {
+            plan->method = method;
+            plan->block = block;
+            plan->length = length;
+            plan->seconds = seconds;
+        }
+    }
+}
+
+/**
+ @method `conv_plan_matrix`
+ `conv_plan` for a convolution matrix of `inputs` x `outputs` impulse responses: either one
+ transform over the whole result (conv_matrix.c), or partitions with shared delay lines
+ (conv_mimo.c, reported as CONV_METHOD_OLS)
+*/
+void conv_plan_matrix(t_conv_plan* plan, long signal_length, long ir_length, long inputs, long outputs, long latency) {
+    long out_length = signal_length + ir_length - 1;
+    long n = fft_good_size(out_length);
+    long block = conv_plan_block(CONV_METHOD_OLS, ir_length, latency);
+    long paths = inputs*outputs;
+
+    plan->method = CONV_METHOD_FFT;
+    plan->block = 0;
+    plan->length = n;
+    plan->seconds = conv_plan_fft_factor(n)*(fft_cost(n) + CONV_COST_PACK*(double)n)*(double)(inputs + paths + outputs);
+
+    if (block >= CONV_PLAN_MIN_BLOCK) {
+        double seconds = conv_plan_fft_factor(2*block)*((double)out_length*conv_mimo_cost(ir_length, block, inputs, outputs)
+                                                        + (double)(paths*((ir_length + block - 1)/block))*fft_cost(2*block));
+
+        if (latency > 0 || seconds < plan->seconds) {
+            plan->method = CONV_METHOD_OLS;
+            plan->block = block;
+            plan->length = 0;
+            plan->seconds = seconds;
+        }
+    }
+}
+
+/**
+ @method `conv_plan_batch`
+ `conv_plan` for one impulse response over many signals, prepared once for all of them: either the
+ direct method, or uniformly partitioned overlap-save with the partition spectra shared (the single
+ transform depends on each signal's length, and nupols only pays off under a latency)
+
+ - Parameters:
+    - signal_length: total length of the signals (every channel of every one)
+*/
+void conv_plan_batch(t_conv_plan* plan, long signal_length, long ir_length, long latency) {
+    long block = conv_plan_block(CONV_METHOD_OLS, ir_length, latency);
+
+    plan->method = CONV_METHOD_DIRECT;
+    plan->block = 0;
+    plan->length = 0;
+    plan->seconds = conv_plan_estimate(CONV_METHOD_DIRECT, signal_length, ir_length, 1, 0, NULL);
+
+    if (block >= CONV_PLAN_MIN_BLOCK) {
+        double seconds = conv_plan_estimate(CONV_METHOD_OLS, signal_length, ir_length, 1, block, NULL);
+
+        if (seconds < plan->seconds) {
+            plan->method = CONV_METHOD_OLS;
+            plan->block = block;
+            plan->seconds = seconds;
+        }
+    }
+}
+
+const char* conv_method_name(int method) {
+    return method >= 0 && method < CONV_METHOD_COUNT ? conv_method_names[method] : "?";
+}
+
+/**
+ @method `conv_calibrate`
+ time transforms of every size in the calibration table, and the direct method, on this machine.
+ takes about a second.
+
+ - Returns: 0 on success, 1 if memory ran out (the calibration is unchanged)
+*/
+short conv_calibrate(void) {
+    double fft_seconds[CONV_PLAN_SIZES];
+    double tap_seconds = conv_calibrate_direct();
+
+    if (tap_seconds <= 0.) return 1;
+
+    for (long i = 0; i < CONV_PLAN_SIZES; i++) {
+        fft_seconds[i] = conv_calibrate_fft(1L << (CONV_PLAN_MIN_LOG2N + 2*i));
+        if (fft_seconds[i] <= 0.) return 1;
+    }
+
+    memcpy(conv_plan_fft_seconds, fft_seconds, sizeof(fft_seconds));
+    conv_plan_tap_seconds = tap_seconds;
+    return 0;
+}
+
+/**
+ @method `conv_calibration_export`
+ write the calibration table as text: "conv direct <seconds per tap>", then one
+ "conv fft <log2n> <seconds per unit>" line per size
+
+ - Returns: the length of the whole text (like `fft_wisdom_export`)
+*/
+long conv_calibration_export(char* text, long size) {
+    long length = 0;
+    char line[64];
+
+    for (long i = -1; i < CONV_PLAN_SIZES; i++) {
+        long count;
+
+        if (i < 0) count = snprintf(line, sizeof(line), "conv direct %.6g\n", conv_plan_tap_seconds);
+        else count = snprintf(line, sizeof(line), "conv fft %ld %.6g\n", CONV_PLAN_MIN_LOG2N + 2*i, conv_plan_fft_seconds[i]);
+
+        if (length + count < size) memcpy(text + length, line, count + 1);
+        length += count;
+    }
+
+    return length;
+}
+
+/* read the "conv" lines of text from `conv_calibration_export` (anything else is skipped) */
+void conv_calibration_import(const char* text) {
+    for (const char* line = text; line; line = strchr(line, '\n')) {
+        double seconds;
+        long log2n;
+
+        if (*line == '\n') line++;
+
+        if (sscanf(line, "conv direct %lf", &seconds) == 1 && seconds > 0.) {
+            conv_plan_tap_seconds = seconds;
+        } else if (sscanf(line, "conv fft %ld %lf", &log2n, &seconds) == 2 && seconds > 0. &&
+                   log2n >= CONV_PLAN_MIN_LOG2N && log2n <= CONV_PLAN_MAX_LOG2N && !(log2n & 1)) {
+            conv_plan_fft_seconds[(log2n - CONV_PLAN_MIN_LOG2N)/2] = seconds;
+        }
+    }
+}
+
+/* estimated seconds for a method (and the transform length of the single-FFT one) */
+static double conv_plan_estimate(int method, long signal_length, long ir_length, long channels, long block, long* length) {
+    long out_length = signal_length + ir_length - 1;
+    long partitions, n;
+
+    switch (method) {
+        case CONV_METHOD_DIRECT:
+            return conv_plan_tap_seconds*(double)channels*(double)signal_length*(double)ir_length;
+
+        case CONV_METHOD_FFT:
+            n = fft_good_size(out_length);
+            if (length) *length = n;
+            return conv_plan_fft_factor(n)*(fft_cost(n)*(double)(1 + 2*channels) + CONV_COST_PACK*(double)n*(double)(channels + 1));
+
+        case CONV_METHOD_OLS:
+            partitions = (ir_length + block - 1)/block;
+            return conv_plan_fft_factor(2*block)*((double)channels*(double)out_length*conv_ols_cost(ir_length, block)
+                                                  + (double)partitions*fft_cost(2*block));
+
+        case CONV_METHOD_NUPOLS:
+            return conv_plan_fft_factor(2*block)*((double)channels*(double)out_length*conv_nupols_cost(ir_length, block, 0)
+                                                  + 2.0*(double)ir_length/(double)block*fft_cost(2*block));
+    }
+
+    return 0.;
+}
+
+/* seconds per unit for a transform of length n, interpolated between the table's sizes */
+static double conv_plan_fft_factor(long n) {
+    double position = (log2((double)n) - CONV_PLAN_MIN_LOG2N)/2.0;
+    long i;
+
+    if (position <= 0.) return conv_plan_fft_seconds[0];
+    if (position >= CONV_PLAN_SIZES - 1) return conv_plan_fft_seconds[CONV_PLAN_SIZES - 1];
+
+    i = (long)position;
+    return conv_plan_fft_seconds[i] + (position - (double)i)*(conv_plan_fft_seconds[i + 1] - conv_plan_fft_seconds[i]);
+}
+
+/* partition length for a partitioned method: the offline optimum, or the largest power of two the
+   latency allows (the first partition, for nupols) */
+static long conv_plan_block(int method, long ir_length, long latency) {
+    long block = conv_ols_block_size(ir_length);
+
+    if (method != CONV_METHOD_OLS && method != CONV_METHOD_NUPOLS) return 0;
+    if (latency <= 0) return block;
+
+    while (block > latency) block /= 2;
+    if (method == CONV_METHOD_NUPOLS) {
+        while (2*block <= latency) block *= 2;
+    }
+
+    return block;
+}
+
+/* seconds per unit of a forward + inverse pair of length n (best of three runs, 0 if it failed) */
+static double conv_calibrate_fft(long n) {
+    t_fft_dft_setup* forward = fft_cache_acquire(n, FFT_FORWARD);
+    t_fft_dft_setup* inverse = fft_cache_acquire(n, FFT_INVERSE);
+    float* data = (float*)calloc(n, sizeof(float));
+    t_fft_split spectrum;
+    short failed = !forward || !inverse || !data;
+    double best = 0.;
+
+    spectrum.realp = data;
+    spectrum.imagp = data + n/2;
+
+    for (int run = 0; run < 3 && !failed; run++) {
+        long reps = 0;
+        double start = conv_calibrate_now(), elapsed;
+
+        do {
+            failed = fft_dft_execute(forward, &spectrum) || fft_dft_execute(inverse, &spectrum);
+            reps++;
+            elapsed = conv_calibrate_now() - start;
+        } while (!failed && elapsed < CONV_CALIBRATE_SECONDS);
+
+        if (!failed && (best == 0. || elapsed/reps < best)) best = elapsed/reps;
+    }
+    if (failed) best = 0.;
+
+    free(data);
+    fft_cache_release(inverse);
+    fft_cache_release(forward);
+    return best/(2.0*fft_cost(n));
+}
+
+/* seconds per tap of `conv_direct` on a short filter (best of three runs, 0 if it failed) */
+static double conv_calibrate_direct(void) {
+    long signal_length = 16384, ir_length = 64;
+    long out_length = signal_length + ir_length - 1;
+    float* signal = (float*)calloc(signal_length, sizeof(float));
+    float* ir = (float*)calloc(ir_length, sizeof(float));
+    float* out = (float*)malloc(sizeof(float)*out_length);
+    double best = 0.;
+
+    for (int run = 0; run < 3 && signal && ir && out; run++) {
+        long reps = 0;
+        double start = conv_calibrate_now(), elapsed;
+
+        do {
+            conv_direct(signal, signal_length, ir, ir_length, out, out_length);
+            reps++;
+            elapsed = conv_calibrate_now() - start;
+        } while (elapsed < CONV_CALIBRATE_SECONDS);
+
+        if (best == 0. || elapsed/reps < best) best = elapsed/reps;
+    }
+
+    free(out);
+    free(ir);
+    free(signal);
+    return best/((double)signal_length*(double)ir_length);
+}
+
+static double conv_calibrate_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec;
+}
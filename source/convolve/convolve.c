@@ -8,27 +8,161 @@
 #include "ext.h"                    // standard Max include, always required
 #include "ext_obex.h"               // required for new style Max object
 #include "ext_buffer.h"             // for reading buffers
+#include "ext_sysparallel.h"        // worker threads for long transforms
+#include "ext_systhread.h"          // the impulse response loader of `convolvebank`
 
 #include <math.h>
-#include <Accelerate/Accelerate.h>  // includes vDSP functions for DFT (must be added as framework in XCode)
+#include <string.h>
+#include "fft.h"                    // portable real FFT (same packing as vDSP's fft_zrip)
+#include "conv.h"                   // partitioned convolution engines
+#include "wav.h"                    // reading impulse responses from .wav files
+
+#define CONVOLVE_WISDOM_FILE "convolve-wisdom.txt"   // FFT timings from `tune`, loaded at startup
+#define CONVOLVE_TUNE_MIN_LOG2N 8
+#define CONVOLVE_TUNE_MAX_LOG2N 24
+#define CONVOLVE_BANK_AHEAD 2       // impulse responses `convolvebank` loads ahead, per worker
+#define CONVOLVE_FILE_CHUNK 4096    // samples `convolvefile` converts to 16 bits at a time
+#define CONVOLVE_WAV_HEADER 44      // bytes before the samples in `write_wav`'s files
+#define CONVOLVE_WAV_MAX 0xFFFFFFFFULL  // largest size the 32-bit fields of a .wav header can hold
 
 // object typedef, any attrs included here
 typedef struct _convolve {
-    t_object    ob;     // the object itself (must be first)
-    void*       done;   // bang outlet
+    t_object    ob;         // the object itself (must be first)
+    void*       done;       // bang outlet
+    void*       info;       // reports the method picked for each job
+    t_atom_long latency;    // largest block a job may wait for (samples, 0: offline)
+    t_symbol*   pairing;    // which channels get convolved together (see `convolve_pairing`)
+    t_atom_long exact;      // whole-signal transforms at the exact length rather than a padded one
 } t_convolve;
 
+/* one channel of the output: the input channels it convolves, and the result */
+typedef struct _convolve_pair {
+    float*      samples1;
+    float*      samples2;
+    float*      result;     // conv_length samples, or NULL if it failed
+} t_convolve_pair;
+
+/* every channel of one `convolve` message, split between the workers */
+typedef struct _convolve_channels {
+    t_convolve*         x;
+    t_convolve_pair*    pairs;
+    long                count;
+    long                length1;
+    long                length2;
+    t_conv_plan         plan;
+} t_convolve_channels;
+
+/* one signal of a `convolvebatch` message, and its result */
+typedef struct _convolve_signal {
+    t_symbol*       name;
+    t_buffer_ref*   ref;
+    t_buffer_obj*   buffer;     // NULL if it was skipped
+    float*          samples;    // its interleaved frames (while locked)
+    long            frames;
+    long            channels;
+    float*          result;     // frames + ir_length - 1 interleaved frames, or NULL if it failed
+} t_convolve_signal;
+
+/* the signals of one round of a `convolvebatch` message, split between the workers */
+typedef struct _convolve_batch {
+    t_convolve*         x;
+    t_convolve_signal*  signals;
+    long                count;
+    float*              ir;
+    long                ir_length;
+    const t_conv_ols*   ols;        // the partitioned impulse response, or NULL for the direct method
+} t_convolve_batch;
+
+/* one impulse response of a `convolvebank` folder */
+typedef struct _convolve_ir {
+    char        name[MAX_FILENAME_CHARS];
+    long        frames;
+    long        channels;
+    float*      samples;    // interleaved frames, once loaded (NULL if loading failed)
+} t_convolve_ir;
+
+/* one `convolvebank` message: the signal's spectra, and the impulse responses on their way from
+   the loader to the workers */
+typedef struct _convolve_bank {
+    t_convolve*         x;
+    t_convolve_ir*      irs;        // sorted by name
+    long                count;
+    short               folder;     // where they are
+    short               path;       // where the results go
+    const char*         chosen;     // the file name picked in the dialog
+    t_symbol*           names;      // a template for the results' names (see `convolve_bank_filename`), or NULL
+    long                length;     // signal length
+    long                channels;   // signal channels
+    double              sample_rate;
+    long                fft_length; // fits the signal through the longest impulse response
+    t_fft_dft_setup*    forward;
+    t_fft_dft_setup*    inverse;
+    float*              spectra;    // the signal's, fft_length floats per channel
+    t_systhread_mutex   mutex;
+    t_systhread_cond    changed;    // an impulse response was loaded or taken
+    long                loaded;     // irs[0 .. loaded) are ready (or failed)
+    long                taken;      // irs[0 .. taken) are with the workers
+    long                ahead;      // most that may be loaded but not yet taken
+    long                written;
+} t_convolve_bank;
+
+/* one `fft_parallel_run` call, handed to the sysparallel workers */
+typedef struct _convolve_job {
+    t_fft_job   job;
+    void*       data;
+    long        count;
+} t_convolve_job;
+
 void *convolve_new(t_symbol *s, long argc, t_atom *argv);
 void convolve_free(t_convolve *x);
 void convolve_assist(t_convolve* x, void *b, long m, long a, char *s);
 void convolve_defer(t_convolve* x, t_symbol* sym, short argc, t_atom* argv);
 void convolve_main(t_convolve *x, t_symbol* sym, short argc, t_atom *argv);
-void init_spectrum(t_convolve* x, DSPSplitComplex* spectrum, long fft_length, float* samples, long sig_length, short pack);
-short get_log2(long n);
+void convolve_batch_defer(t_convolve* x, t_symbol* sym, short argc, t_atom* argv);
+void convolve_batch(t_convolve* x, t_symbol* sym, short argc, t_atom* argv);
+void convolve_batch_job(void* data, long index, long count);
+void convolve_batch_filename(char* filename, const char* chosen, const char* signal);
+void convolve_normalize(float* samples, long count);
+void convolve_bank_defer(t_convolve* x, t_symbol* sym, short argc, t_atom* argv);
+void convolve_bank(t_convolve* x, t_symbol* sym, short argc, t_atom* argv);
+long convolve_bank_scan(t_convolve* x, short folder, t_convolve_ir** irs);
+void* convolve_bank_loader(t_convolve_bank* bank);
+void convolve_bank_job(void* data, long index, long count);
+void convolve_bank_render(t_convolve_bank* bank, t_convolve_ir* ir, float* spectrum, float* samples);
+void convolve_bank_filename(char* filename, const t_convolve_bank* bank, const t_convolve_ir* ir, long index);
+int convolve_bank_compare(const void* a, const void* b);
+void convolve_file_defer(t_convolve* x, t_symbol* sym, short argc, t_atom* argv);
+void convolve_file(t_convolve* x, t_symbol* sym, short argc, t_atom* argv);
+short convolve_file_output(const char* pathname, short* path, char* filename);
+short convolve_file_stream(t_convolve* x, t_wav_reader* wav, t_conv_ols** engines, long out_channels, long step1,
+                           long out_length, t_filehandle out, float* peak);
+short convolve_file_finish(t_filehandle file, long count, float gain);
+void convolve_kernel(t_convolve* x, t_symbol* sym, long argc, t_atom* argv);
+void convolve_tune_defer(t_convolve* x, t_symbol* sym, short argc, t_atom* argv);
+void convolve_tune(t_convolve* x, t_symbol* sym, short argc, t_atom* argv);
+void convolve_wisdom_load(void);
+float* convolve_channels(t_convolve* x, float* samples1, long length1, long channels1, long step1,
+                         float* samples2, long length2, long channels2, long step2, long out_channels);
+float* convolve_matrix(t_convolve* x, float* signal, long signal_length, float* irs, long ir_length, long inputs, long outputs);
+void convolve_report(t_convolve* x, const t_conv_plan* plan);
+long convolve_pairing(t_convolve* x, long channels1, long channels2, long* step1, long* step2);
+float* convolve_deinterleave(t_convolve* x, float* samples, long frames, long channels, long channel);
+void convolve_channels_job(void* data, long index, long count);
+float* convolve_pair(t_convolve* x, const t_conv_plan* plan, float* samples1, long length1, float* samples2, long length2);
+float* convolve_fft(t_convolve* x, float* samples1, long length1, float* samples2, long length2);
+float* convolve_direct(t_convolve* x, float* signal, long signal_length, float* ir, long ir_length);
+float* convolve_ols(t_convolve* x, float* signal, long signal_length, float* ir, long ir_length, long block);
+float* convolve_nupols(t_convolve* x, float* signal, long signal_length, float* ir, long ir_length, long block);
+void init_spectrum(t_convolve* x, t_fft_split* spectrum, long fft_length, float* samples, long sig_length, short pack);
 void write_little_endian(t_filehandle* file, int num_bytes, int word);
-void write_wav(t_filehandle* file, unsigned long num_samples, float* data, int s_rate);
+void write_wav(t_filehandle* file, unsigned long num_samples, unsigned int num_channels, float* data, int s_rate);
+void write_wav_header(t_filehandle* file, unsigned long num_samples, unsigned int num_channels, int s_rate);
+void convolve_parallel_run(void* context, t_fft_job job, void* data, long count);
+void convolve_parallel_worker(t_sysparallel_worker* worker);
+void convolve_quit(void);
 
 void *convolve_class; // global pointer to class for use by max
+t_sysparallel_task* convolve_task = NULL; // workers shared by every instance for long FFTs
 
 /* Max instantiation stuff */
 
@@ -48,20 +182,94 @@ C74_EXPORT void ext_main(void *r) {
     /* links convolve message to convolve_main() method */
     class_addmethod(c, (method)convolve_defer, "convolve", A_GIMME, 0);
 
+    /* one impulse response over many signals, each to its own file */
+    class_addmethod(c, (method)convolve_batch_defer, "convolvebatch", A_GIMME, 0);
+
+    /* one signal through every impulse response in a folder, each to its own file */
+    class_addmethod(c, (method)convolve_bank_defer, "convolvebank", A_GIMME, 0);
+
+    /* a .wav file of any length through an impulse response, streamed from disk to disk */
+    class_addmethod(c, (method)convolve_file_defer, "convolvefile", A_GIMME, 0);
+
+    /* reports (or forces) the SIMD kernels used by the FFT */
+    class_addmethod(c, (method)convolve_kernel, "kernel", A_GIMME, 0);
+
+    /* times the FFT algorithms on this machine and saves the winners */
+    class_addmethod(c, (method)convolve_tune_defer, "tune", A_GIMME, 0);
+
+    /* largest block a job may wait for; anything but 0 rules out the single-transform method */
+    CLASS_ATTR_LONG(c, "latency", 0, t_convolve, latency);
+    CLASS_ATTR_FILTER_MIN(c, "latency", 0);
+    CLASS_ATTR_LABEL(c, "latency", 0, "Latency (samples, 0 = offline)");
+
+    /* how the channels of multichannel buffers are paired up (see `convolve_pairing`) */
+    CLASS_ATTR_SYM(c, "pairing", 0, t_convolve, pairing);
+    CLASS_ATTR_ENUM(c, "pairing", 0, "auto 1toN NtoN Nto1 truestereo matrix");
+    CLASS_ATTR_LABEL(c, "pairing", 0, "Channel Pairing");
+
+    /* transforms over the whole result at its exact length (usually slower, and no leaner: see fft_exact_size) */
+    CLASS_ATTR_LONG(c, "exact", 0, t_convolve, exact);
+    CLASS_ATTR_STYLE_LABEL(c, "exact", 0, "onoff", "Exact-Length Transforms");
+
     /* assistance messaging on inlets/outlets */
     class_addmethod(c, (method)convolve_assist, "assist", A_CANT, 0);
 
     class_register(CLASS_BOX, c);
     convolve_class = c;
+
+    /* pick the widest SIMD kernels this CPU supports (once, for every instance) */
+    fft_init();
+
+    /* use the algorithms `tune` found fastest, if it has been run on this machine */
+    convolve_wisdom_load();
+
+    /* split long transforms between the physical cores (hyperthreads don't help a memory-bound FFT) */
+    long cores = sysparallel_physical_processorcount();
+    if (cores > 1 && (convolve_task = sysparallel_task_new(NULL, (method)convolve_parallel_worker, cores))) {
+        fft_set_parallel(convolve_parallel_run, convolve_task, cores);
+    }
+
+    /* free the cached FFT setups and the workers when Max quits */
+    quittask_install((method)convolve_quit, NULL);
+}
+
+void convolve_quit(void) {
+    fft_set_parallel(NULL, NULL, 1);
+    if (convolve_task) sysparallel_task_free(convolve_task);
+    convolve_task = NULL;
+    fft_cache_clear();
+}
+
+/**
+ @method `convolve_parallel_run`
+ the FFT's runner: executes job(data, i, count) on `count` sysparallel workers and waits for them
+
+ - Parameter context: the `t_sysparallel_task` to run on
+*/
+void convolve_parallel_run(void* context, t_fft_job job, void* data, long count) {
+    t_sysparallel_task* task = (t_sysparallel_task*)context;
+    t_convolve_job j = {job, data, count};
+
+    sysparallel_task_data(task, &j);
+    sysparallel_task_workercount(task, count);
+    sysparallel_task_execute(task);
+}
+
+void convolve_parallel_worker(t_sysparallel_worker* worker) {
+    t_convolve_job* j = (t_convolve_job*)worker->task->data;
+    j->job(j->data, worker->id, j->count);
 }
 
 void convolve_assist(t_convolve *x, void *b, long m, long a, char *s) {
     if (m == ASSIST_INLET) { // inlet
         sprintf(s, "(message): convolve output_buffer IR_buffer signal_buffer");
     }
-    else { // outlet
+    else if (a == 0) { // outlet
         sprintf(s, "bang on success");
     }
+    else {
+        sprintf(s, "plan: method, block or transform length, estimated seconds");
+    }
 }
 
 void convolve_free(t_convolve *x) {
@@ -73,11 +281,119 @@ void *convolve_new(t_symbol *s, long argc, t_atom *argv) {
     long i;
 
     x = (t_convolve *)object_alloc(convolve_class);
+    x->info = outlet_new((t_object*)x, NULL);   // outlets are created right to left
     x->done = bangout((t_object*)x);
+    x->latency = 0;
+    x->pairing = gensym("auto");
+    x->exact = 0;
+    attr_args_process(x, (short)argc, argv);
 
     return x;
 }
 
+/**
+ @method `convolve_kernel`
+ `kernel` posts the name of the SIMD kernels the FFT is using. `kernel <name>` forces a specific
+ set (scalar, sse2, avx2, avx512, neon, or auto) for every instance, which is mostly useful for
+ testing and benchmarking.
+*/
+void convolve_kernel(t_convolve* x, t_symbol* sym, long argc, t_atom* argv) {
+    if (argc && atom_gettype(argv) == A_SYM && fft_force_kernel(atom_getsym(argv)->s_name)) {
+        object_error((t_object*)x, "%s kernels aren't supported on this machine", atom_getsym(argv)->s_name);
+    }
+
+    object_post((t_object*)x, "using %s FFT kernels", fft_kernel_name());
+}
+
+/**
+ @method `convolve_tune`
+ `tune [max_log2n]` times every FFT algorithm for the power-of-two lengths up to 2^max_log2n
+ (2^24 by default), then calibrates the convolution planner (see conv_plan.c), and saves both to
+ convolve-wisdom.txt, which is loaded again whenever the external is. blocks Max for a while, so
+ it's meant to be run once per machine.
+*/
+void convolve_tune_defer(t_convolve* x, t_symbol* sym, short argc, t_atom* argv) {
+    defer(x, (method)convolve_tune, sym, argc, argv);
+}
+
+void convolve_tune(t_convolve* x, t_symbol* sym, short argc, t_atom* argv) {
+    long max_log2n = argc ? (long)atom_getlong(argv) : CONVOLVE_TUNE_MAX_LOG2N;
+    char name[MAX_FILENAME_CHARS];
+    t_fourcc type;
+    t_filehandle file;
+    t_ptr_size size;
+    short path;
+    char* text;
+
+    if (max_log2n < CONVOLVE_TUNE_MIN_LOG2N) max_log2n = CONVOLVE_TUNE_MIN_LOG2N;
+
+    object_post((t_object*)x, "timing FFTs up to 2^%ld, this can take a minute...", max_log2n);
+    if (fft_tune(CONVOLVE_TUNE_MIN_LOG2N, max_log2n)) {
+        object_error((t_object*)x, "not enough memory to tune the FFT");
+        return;
+    }
+
+    for (long log2n = CONVOLVE_TUNE_MIN_LOG2N; log2n <= max_log2n; log2n++) {
+        object_post((t_object*)x, "2^%ld: %s", log2n, fft_strategy_name(fft_strategy(log2n)));
+    }
+
+    /* setups built before tuning still use the old choice */
+    fft_cache_clear();
+
+    /* the planner's timings depend on the FFT algorithms, so they're measured after them */
+    if (conv_calibrate()) object_error((t_object*)x, "not enough memory to calibrate the planner");
+
+    /* overwrite the wisdom that was loaded, or start a new file in the default folder */
+    strcpy(name, CONVOLVE_WISDOM_FILE);
+    if (locatefile_extended(name, &path, &type, NULL, 0)) path = path_getdefault();
+
+    /* the FFT wisdom, followed by the planner's calibration */
+    long fft_size = fft_wisdom_export(NULL, 0);
+    size = fft_size + conv_calibration_export(NULL, 0);
+    text = (char*)malloc(size + 1);
+    if (!text) {
+        object_error((t_object*)x, "not enough memory to save the tuning to %s (it applies until Max quits)", name);
+        return;
+    }
+    fft_wisdom_export(text, fft_size + 1);
+    conv_calibration_export(text + fft_size, size - fft_size + 1);
+
+    if (path_createsysfile(name, path, 'TEXT', &file)) {
+        object_error((t_object*)x, "could not write %s", name);
+    } else {
+        if (sysfile_write(file, &size, text)) object_error((t_object*)x, "could not write %s", name);
+        sysfile_close(file);
+    }
+
+    free(text);
+}
+
+/* load convolve-wisdom.txt (FFT wisdom and planner calibration) from the search path, if `tune` has written one */
+void convolve_wisdom_load(void) {
+    char name[MAX_FILENAME_CHARS];
+    t_fourcc type;
+    t_filehandle file;
+    t_ptr_size size = 0;
+    short path;
+    char* text;
+
+    strcpy(name, CONVOLVE_WISDOM_FILE);
+    if (locatefile_extended(name, &path, &type, NULL, 0)) return;
+    if (path_opensysfile(name, path, &file, READ_PERM)) return;
+
+    sysfile_geteof(file, &size);
+    text = (char*)malloc(size + 1);
+
+    if (text && !sysfile_read(file, &size, text)) {
+        text[size] = 0;
+        if (fft_wisdom_import(text)) error("convolve: %s isn't FFT wisdom, ignoring it", name);
+        else conv_calibration_import(text);
+    }
+
+    free(text);
+    sysfile_close(file);
+}
+
 /* main convolve methods */
 
 void convolve_defer(t_convolve* x, t_symbol* sym, short argc, t_atom* argv) {
@@ -97,24 +413,47 @@ void convolve_main(t_convolve* x, t_symbol* sym, short argc, t_atom* argv) {
     t_buffer_obj* buffin1 = buffer_ref_getobject(ref_buffin1);
     t_buffer_obj* buffin2 = buffer_ref_getobject(ref_buffin2);
 
-    t_atom_long framecount1 = buffer_getframecount(buffin1); // # samples
+    t_atom_long framecount1 = buffer_getframecount(buffin1); // # samples (per channel)
     t_atom_long framecount2 = buffer_getframecount(buffin2);
+    t_atom_long channels1 = buffer_getchannelcount(buffin1);
+    t_atom_long channels2 = buffer_getchannelcount(buffin2);
     t_atom_float sr1 = buffer_getsamplerate(buffin1);
     t_atom_float sr2 = buffer_getsamplerate(buffin2);
 
-    if (buffer_getchannelcount(buffin1) || buffer_getchannelcount(buffin2)) {
-
-    }
-
     if (framecount1 < 8 || framecount2 < 8) {
         object_error((t_object*)x, "at least one input buffer is too short");
         return;
-    } else if (buffer_getchannelcount(buffin1) > 1 || buffer_getchannelcount(buffin2) > 1) {
-        object_warn((t_object*)x, "this object doesn't support non-mono signals... your output will probably be stretched!");
     } else if (sr1 != sr2) {
         object_warn((t_object*)x, "input buffers have varying sample rates");
     }
 
+    /* convolution matrices: a signal of M channels through M*N impulse responses, in whichever
+       buffer has more channels (true stereo is the 2 x 2 case: LL, LR, RL, RR) */
+    short matrix = x->pairing == gensym("matrix") || x->pairing == gensym("truestereo");
+    short swap = matrix && channels2 < channels1;   // the signal is in buffer 2
+    long inputs = swap ? (long)channels2 : (long)channels1;
+    long step1 = 0, step2 = 0;
+    long out_channels;
+
+    if (matrix) {
+        long paths = swap ? (long)channels1 : (long)channels2;
+
+        if (inputs < 1) inputs = 1;
+        out_channels = paths/inputs;
+
+        if (x->pairing == gensym("truestereo") && !(inputs == 2 && paths == 4)) {
+            object_error((t_object*)x, "truestereo needs a stereo buffer and a 4-channel one (LL, LR, RL, RR)");
+            return;
+        } else if (paths % inputs || inputs > CONV_MIMO_MAX_CHANNELS || out_channels > CONV_MIMO_MAX_CHANNELS) {
+            object_error((t_object*)x, "matrix needs a multiple of the signal's %ld channels of impulse responses (not %ld)", inputs, paths);
+            return;
+        }
+    } else {
+        /* which channel of each input every output channel convolves */
+        out_channels = convolve_pairing(x, (long)channels1, (long)channels2, &step1, &step2);
+        if (!out_channels) return;
+    }
+
     /* prepare output file */
     t_fourcc filetype='WAVE', outtype;
     short numtypes = 1;
@@ -122,87 +461,1243 @@ void convolve_main(t_convolve* x, t_symbol* sym, short argc, t_atom* argv) {
     short path;
     if (saveasdialog_extended(filename, &path, &outtype, &filetype, 1)) return;
 
-    /* retrieve input samples */
+    /* retrieve input samples (interleaved frames) */
     float* samples1 = buffer_locksamples(buffin1);
     float* samples2 = buffer_locksamples(buffin2);
 
     /* length of the signal after convolution is length1 + length2 - 1 */
-    long fft_length = framecount1 + framecount2 - 1;
+    long conv_length = framecount1 + framecount2 - 1;
 
-    /* set fft_length next highest power of 2 */
-    short log2n = get_log2(fft_length);
-    fft_length = 1U << log2n;
+    /* the result, as interleaved frames */
+    float* samples;
+    if (matrix && !swap) {
+        samples = convolve_matrix(x, samples1, framecount1, samples2, framecount2, inputs, out_channels);
+    } else if (matrix) {
+        samples = convolve_matrix(x, samples2, framecount2, samples1, framecount1, inputs, out_channels);
+    } else {
+        samples = convolve_channels(x, samples1, framecount1, channels1, step1, samples2, framecount2, channels2, step2, out_channels);
+    }
 
-    /* find spectrums of both signals */
-    DSPSplitComplex spectrum1;  // input 1
-    DSPSplitComplex spectrum2;  // input 2
-    DSPSplitComplex spectrum;   // output
-    init_spectrum(x, &spectrum1, fft_length, samples1, framecount1, 1);
-    init_spectrum(x, &spectrum2, fft_length, samples2, framecount2, 1);
-    init_spectrum(x, &spectrum,  fft_length, NULL,     NULL,        0);
+    buffer_unlocksamples(buffin2);
+    buffer_unlocksamples(buffin1);
+    if (!samples) return;
 
-    /* pre-compute FFT bins */
-    FFTSetup setup = vDSP_create_fftsetup(log2n, FFT_RADIX2);
+    /* normalization (to the peak of all channels, so the output doesn't clip and keeps its balance) */
+    convolve_normalize(samples, conv_length*out_channels);
 
-    if (!setup) {
-        object_error((t_object *) x, "could not pre-compute FFT bins");
+    /* write to .WAV file */
+    t_filehandle file;
+    if (path_createsysfile(filename, path, 'WAVE', &file)) {
+        object_error((t_object*)x, "could not create output file");
+        free(samples);
         return;
     }
 
-    /* compute FFT */
-    vDSP_fft_zrip(setup, &spectrum1, 1, get_log2(framecount1), kFFTDirection_Forward);
-    vDSP_fft_zrip(setup, &spectrum2, 1, get_log2(framecount2), kFFTDirection_Forward);
+    write_wav(&file, conv_length, (unsigned int)out_channels, samples, sr1);
+    free(samples);
 
-    /* data packing is weird. this preserves nyquist bin for spectrum multiplication */
-    float nyq1 = spectrum1.imagp[0];
-    float nyq2 = spectrum2.imagp[0];
-    spectrum1.imagp[0] = 0;
-    spectrum2.imagp[0] = 0;
+    /* bang! */
+    outlet_bang(x->done);
+}
 
-    /* multiply both spectrums (time-domain convolution) */
-    vDSP_zvmul(&spectrum1, 1, &spectrum2, 1, &spectrum, 1, fft_length/2, 1);
+void convolve_batch_defer(t_convolve* x, t_symbol* sym, short argc, t_atom* argv) {
+    defer(x, (method)convolve_batch, sym, argc, argv);
+}
 
-    spectrum.imagp[0] = nyq1 * nyq2;
+/**
+ @method `convolve_batch`
+ `convolvebatch ir signal1 signal2 ...`: every signal buffer through the first channel of the
+ impulse response buffer, channel by channel. the response is prepared once for all of them (its
+ partition spectra, unless it is short enough for the direct method, see `conv_plan_batch`), and
+ the signals run side by side on the workers, one per worker at a time. a single dialog names the
+ results: choosing name.wav writes name-signal1.wav, name-signal2.wav, ... next to it, each
+ normalized on its own.
+*/
+void convolve_batch(t_convolve* x, t_symbol* sym, short argc, t_atom* argv) {
+    if (argc < 2) {
+        object_error((t_object*)x, "usage: (convolvebatch IR_buffer signal_buffer1 signal_buffer2 ...)");
+        return;
+    }
 
-    /* inverse DFT result to time-domain (convoluted signal stored in spectrum) */
-    vDSP_fft_zrip(setup, &spectrum, 1, log2f(framecount1 + framecount2 - 1), kFFTDirection_Inverse);
+    t_buffer_ref* ref_ir = buffer_ref_new((t_object*)x, atom_getsym(argv));
+    t_buffer_obj* buffer_ir = buffer_ref_getobject(ref_ir);
+    t_atom_long ir_length = buffer_getframecount(buffer_ir);
+    t_atom_long ir_channels = buffer_getchannelcount(buffer_ir);
+    t_atom_float sr = buffer_getsamplerate(buffer_ir);
+    long count = argc - 1;
+    long total = 0;
 
-    /* unpack to output buffer */
-    float* samples = (float*)malloc(sizeof(float)*fft_length/2);
-    vDSP_ztoc(&spectrum, 1, (DSPComplex*)samples, 2, (long)fft_length/4);
+    if (ir_length < 8) {
+        object_error((t_object*)x, "impulse response buffer %s is too short", atom_getsym(argv)->s_name);
+        object_free(ref_ir);
+        return;
+    } else if (ir_channels > 1) {
+        object_warn((t_object*)x, "only using the first channel of %s", atom_getsym(argv)->s_name);
+    }
 
-    /* normalization */
-    float scale = 1.f/samples[0];
-    vDSP_vsmul(samples, 1, &scale, samples, 1, fft_length/2);
+    t_convolve_signal* signals = (t_convolve_signal*)calloc(count, sizeof(t_convolve_signal));
+    if (!signals) {
+        object_error((t_object*)x, "could not allocate memory for %ld signals", count);
+        object_free(ref_ir);
+        return;
+    }
 
-    /* write to .WAV file */
-    t_filehandle file;
-    if (path_createsysfile(filename, path, 'WAVE', &file)) {
-        object_error((t_object*)x, "could not create output file");
+    /* gather the signals (leaving out any that are missing or too short) */
+    for (long s = 0; s < count; s++) {
+        t_convolve_signal* signal = signals + s;
+
+        signal->name = atom_getsym(argv + 1 + s);
+        signal->ref = buffer_ref_new((t_object*)x, signal->name);
+        signal->buffer = buffer_ref_getobject(signal->ref);
+        signal->frames = (long)buffer_getframecount(signal->buffer);
+        signal->channels = (long)buffer_getchannelcount(signal->buffer);
+        if (signal->channels < 1) signal->channels = 1;
+
+        if (signal->frames < 8) {
+            object_warn((t_object*)x, "signal buffer %s is missing or too short, skipping it", signal->name->s_name);
+            signal->buffer = NULL;
+        } else {
+            if (buffer_getsamplerate(signal->buffer) != sr) {
+                object_warn((t_object*)x, "%s and the impulse response have varying sample rates", signal->name->s_name);
+            }
+            total += signal->frames*signal->channels;
+        }
+    }
+
+    /* prepare output files */
+    t_fourcc filetype='WAVE', outtype;
+    char chosen[MAX_FILENAME_CHARS];
+    short path;
+    if (!total) object_error((t_object*)x, "no signal buffers to convolve");
+    if (!total || saveasdialog_extended(chosen, &path, &outtype, &filetype, 1)) {
+        for (long s = 0; s < count; s++) object_free(signals[s].ref);
+        free(signals);
+        object_free(ref_ir);
+        return;
+    }
+
+    /* the impulse response, prepared once */
+    t_convolve_batch batch = {x, NULL, 0, NULL, (long)ir_length, NULL};
+    t_conv_ols* ols = NULL;
+    t_conv_plan plan;
+    float* samples_ir = buffer_locksamples(buffer_ir);
+
+    conv_plan_batch(&plan, total, (long)ir_length, (long)x->latency);
+    convolve_report(x, &plan);
+
+    batch.ir = convolve_deinterleave(x, samples_ir, (long)ir_length, (long)ir_channels, 0);
+    if (batch.ir && plan.method == CONV_METHOD_OLS) {
+        batch.ols = ols = conv_ols_new(batch.ir, (long)ir_length, plan.block);
+        if (!ols) object_error((t_object*)x, "could not allocate memory for the convolution");
+    }
+
+    short failed = !batch.ir || (plan.method == CONV_METHOD_OLS && !ols);
+    long workers = fft_parallel_workers();
+    long lost = 0;      // signals that were convolved but didn't make it to a file
+
+    /* one signal per worker per round, so only that many results are held at once */
+    for (long first = 0; !failed && first < count; first += workers) {
+        batch.signals = signals + first;
+        batch.count = count - first < workers ? count - first : workers;
+
+        for (long s = 0; s < batch.count; s++) {
+            if (batch.signals[s].buffer) batch.signals[s].samples = buffer_locksamples(batch.signals[s].buffer);
+        }
+
+        fft_parallel_run(convolve_batch_job, &batch, batch.count);
+
+        for (long s = 0; s < batch.count; s++) {
+            t_convolve_signal* signal = batch.signals + s;
+            long conv_length = signal->frames + (long)ir_length - 1;
+            char filename[MAX_FILENAME_CHARS];
+            t_filehandle file;
+
+            if (signal->samples) buffer_unlocksamples(signal->buffer);
+            if (!signal->result) {
+                /* the job has posted why (a skipped signal has no samples, and was warned about) */
+                if (signal->samples) lost++;
+                continue;
+            }
+
+            /* write to .WAV file */
+            convolve_normalize(signal->result, conv_length*signal->channels);
+            convolve_batch_filename(filename, chosen, signal->name->s_name);
+
+            if (path_createsysfile(filename, path, 'WAVE', &file)) {
+                object_error((t_object*)x, "could not create output file %s", filename);
+                lost++;
+            } else {
+                write_wav(&file, conv_length, (unsigned int)signal->channels, signal->result,
+                          buffer_getsamplerate(signal->buffer));
+            }
+
+            free(signal->result);
+            signal->result = NULL;
+        }
+    }
+
+    conv_ols_free(ols);
+    if (ir_channels > 1) free(batch.ir);
+    buffer_unlocksamples(buffer_ir);
+    for (long s = 0; s < count; s++) object_free(signals[s].ref);
+    free(signals);
+    object_free(ref_ir);
+
+    /* bang! (only once every signal has its file) */
+    if (lost) object_error((t_object*)x, "could not write %ld of the signals", lost);
+    if (!failed && !lost) outlet_bang(x->done);
+}
+
+/* worker `index` of `count` convolves signals index, index + count, ... of the round, each channel
+   with an engine of its own on the shared partitions */
+void convolve_batch_job(void* data, long index, long count) {
+    t_convolve_batch* batch = (t_convolve_batch*)data;
+    t_conv_ols* ols = NULL;
+
+    if (batch->ols && !(ols = conv_ols_clone(batch->ols))) {
+        object_error((t_object*)batch->x, "could not allocate memory for the convolution");
+        return;
+    }
+
+    for (long s = index; s < batch->count; s += count) {
+        t_convolve_signal* signal = batch->signals + s;
+        long channels = signal->channels;
+        long conv_length = signal->frames + batch->ir_length - 1;
+        float* result;
+        float* out;
+
+        if (!signal->samples) continue;
+
+        result = (float*)malloc(sizeof(float)*conv_length*channels);
+        out = channels > 1 ? (float*)malloc(sizeof(float)*conv_length) : result;
+        if (!result || !out) {
+            object_error((t_object*)batch->x, "could not allocate memory for the output of %s", signal->name->s_name);
+            if (out != result) free(out);
+            free(result);
+            continue;
+        }
+
+        for (long c = 0; result && c < channels; c++) {
+            float* in = convolve_deinterleave(batch->x, signal->samples, signal->frames, channels, c);
+
+            if (!in) {
+                free(result);
+                result = NULL;
+                break;
+            }
+
+            if (ols) conv_ols_run(ols, in, signal->frames, out, conv_length);
+            else conv_direct(in, signal->frames, batch->ir, batch->ir_length, out, conv_length);
+
+            /* interleave the channels into frames (a mono result is already in place) */
+            if (channels > 1) {
+                for (long i = 0; i < conv_length; i++) result[i*channels + c] = out[i];
+                free(in);
+            }
+        }
+
+        if (out != result) free(out);
+        signal->result = result;
+    }
+
+    conv_ols_free(ols);
+}
+
+/* the file for `signal` when the dialog chose `chosen`: name.wav gives name-signal.wav */
+void convolve_batch_filename(char* filename, const char* chosen, const char* signal) {
+    const char* dot = strrchr(chosen, '.');
+    int length = dot && dot != chosen ? (int)(dot - chosen) : (int)strlen(chosen);
+
+    snprintf(filename, MAX_FILENAME_CHARS, "%.*s-%s.wav", length, chosen, signal);
+}
+
+/* scale to a peak of 1 (so the output doesn't clip), unless it is silent */
+void convolve_normalize(float* samples, long count) {
+    float peak = 0.f;
+
+    for (long i = 0; i < count; i++) {
+        if (fabsf(samples[i]) > peak) peak = fabsf(samples[i]);
+    }
+    if (peak > 0.f) fft_vsmul(samples, 1.f/peak, count);
+}
+
+void convolve_bank_defer(t_convolve* x, t_symbol* sym, short argc, t_atom* argv) {
+    defer(x, (method)convolve_bank, sym, argc, argv);
+}
+
+/**
+ @method `convolve_bank`
+ `convolvebank signal folder [template]`: the signal buffer through every .wav impulse response in
+ the folder. this turns `convolve` around: the signal is transformed once, at a length that fits
+ the longest response, and each response costs one forward and one inverse transform. a loader
+ thread reads the responses from disk a few ahead of the workers, and every worker convolves,
+ normalizes and writes whole responses until none are left (their channels pair up with the
+ signal's as in `convolve_pairing`).
+
+ the results go where the dialog points. without a template, choosing name.wav writes
+ name-<response>.wav; a template names them itself, with %s for the response's name (without
+ .wav), %d for its number (in name order, from 1) and %% for a %.
+*/
+void convolve_bank(t_convolve* x, t_symbol* sym, short argc, t_atom* argv) {
+    t_convolve_bank bank;
+    char filename[MAX_FILENAME_CHARS];
+    char chosen[MAX_FILENAME_CHARS];
+    t_fourcc filetype = 'WAVE', outtype;
+    long longest = 0;
+
+    if (argc < 2) {
+        object_error((t_object*)x, "usage: (convolvebank signal_buffer IR_folder [template])");
+        return;
+    } else if (x->pairing == gensym("matrix") || x->pairing == gensym("truestereo")) {
+        object_error((t_object*)x, "convolvebank can't use pairing %s", x->pairing->s_name);
         return;
     }
 
-    write_wav(&file, fft_length/2, samples, sr1);
+    memset(&bank, 0, sizeof(t_convolve_bank));
+    bank.x = x;
+    bank.names = argc > 2 ? atom_getsym(argv + 2) : NULL;
+
+    t_buffer_ref* ref = buffer_ref_new((t_object*)x, atom_getsym(argv));
+    t_buffer_obj* buffer = buffer_ref_getobject(ref);
+    bank.length = (long)buffer_getframecount(buffer);
+    bank.channels = (long)buffer_getchannelcount(buffer);
+    bank.sample_rate = buffer_getsamplerate(buffer);
+
+    if (bank.length < 8) {
+        object_error((t_object*)x, "signal buffer %s is missing or too short", atom_getsym(argv)->s_name);
+        object_free(ref);
+        return;
+    } else if (path_frompathname(atom_getsym(argv + 1)->s_name, &bank.folder, filename) || filename[0]) {
+        object_error((t_object*)x, "could not find folder %s", atom_getsym(argv + 1)->s_name);
+        object_free(ref);
+        return;
+    }
+
+    /* only the headers for now: the longest response decides the transform length */
+    bank.count = convolve_bank_scan(x, bank.folder, &bank.irs);
+    for (long i = 0; i < bank.count; i++) {
+        if (bank.irs[i].frames > longest) longest = bank.irs[i].frames;
+    }
+
+    if (!bank.count) {
+        object_error((t_object*)x, "no impulse responses (.wav) in %s", atom_getsym(argv + 1)->s_name);
+        free(bank.irs);
+        object_free(ref);
+        return;
+    } else if (saveasdialog_extended(chosen, &bank.path, &outtype, &filetype, 1)) {
+        free(bank.irs);
+        object_free(ref);
+        return;
+    }
+    bank.chosen = chosen;
+
+    /* the signal's spectra, once (they're only multiplied, so they stay scrambled) */
+    bank.fft_length = x->exact ? fft_exact_size(bank.length + longest - 1) : fft_good_size(bank.length + longest - 1);
+    bank.forward = fft_cache_acquire(bank.fft_length, FFT_FORWARD);
+    bank.inverse = fft_cache_acquire(bank.fft_length, FFT_INVERSE);
+    bank.spectra = (float*)malloc(sizeof(float)*bank.fft_length*bank.channels);
+
+    short failed = !bank.forward || !bank.inverse || !bank.spectra;
+    if (failed) object_error((t_object*)x, "could not allocate memory for the signal's spectrum");
+
+    float* samples = buffer_locksamples(buffer);
+    for (long c = 0; !failed && c < bank.channels; c++) {
+        float* channel = convolve_deinterleave(x, samples, bank.length, bank.channels, c);
+        t_fft_split spectrum;
+
+        if (!(failed = !channel)) {
+            spectrum.realp = bank.spectra + bank.fft_length*c;
+            spectrum.imagp = spectrum.realp + bank.fft_length/2;
+            memset(spectrum.realp, 0, sizeof(float)*bank.fft_length);
+            fft_ctoz(channel, &spectrum, bank.length);
+            if ((failed = fft_dft_execute_scrambled(bank.forward, &spectrum, bank.length))) {
+                object_error((t_object*)x, "could not allocate memory for the signal's spectrum");
+            }
+        }
+        if (bank.channels > 1) free(channel);
+    }
+    buffer_unlocksamples(buffer);
+
+    /* the loader reads ahead while the workers convolve */
+    if (!failed) {
+        long workers = fft_parallel_workers();
+        t_systhread loader = NULL;
+
+        bank.ahead = CONVOLVE_BANK_AHEAD*workers;
+        systhread_mutex_new(&bank.mutex, 0);
+        systhread_cond_new(&bank.changed, 0);
+
+        if (systhread_create((method)convolve_bank_loader, &bank, 0, 0, 0, &loader)) {
+            object_error((t_object*)x, "could not start loading impulse responses");
+            failed = 1;
+        } else {
+            fft_parallel_run(convolve_bank_job, &bank, workers);
+            systhread_join(loader, NULL);
+        }
+
+        systhread_cond_free(bank.changed);
+        systhread_mutex_free(bank.mutex);
+    }
+
+    free(bank.spectra);
+    fft_cache_release(bank.inverse);
+    fft_cache_release(bank.forward);
+    free(bank.irs);
+    object_free(ref);
+
+    /* bang! (only when every response made it to a file, as with `convolvebatch`) */
+    if (!failed && bank.written < bank.count) {
+        object_error((t_object*)x, "could not write %ld of the impulse responses", bank.count - bank.written);
+    }
+    if (!failed && bank.written == bank.count) outlet_bang(x->done);
+}
+
+/**
+ @method `convolve_bank_scan`
+ the .wav files in a folder that can be read, without their samples
+
+ - Parameter irs: set to them, sorted by name (free with `free`)
+ - Returns: how many there are
+*/
+long convolve_bank_scan(t_convolve* x, short folder, t_convolve_ir** irs) {
+    void* state = path_openfolder(folder);
+    long count = 0, size = 0;
+    char name[MAX_FILENAME_CHARS];
+    t_fourcc type;
+
+    *irs = NULL;
+    if (!state) return 0;
+
+    while (path_foldernextfile(state, &type, name, 0)) {
+        const char* dot = strrchr(name, '.');
+        t_filehandle file;
+        t_wav_reader wav;
+
+        if (!dot || (strcmp(dot, ".wav") && strcmp(dot, ".WAV") && strcmp(dot, ".wave"))) continue;
+
+        if (path_opensysfile(name, folder, &file, READ_PERM)) continue;
+        if (wav_reader_open(&wav, file) || wav.frames < 1) {
+            object_warn((t_object*)x, "can't read %s, skipping it", name);
+            sysfile_close(file);
+            continue;
+        }
+        sysfile_close(file);
+
+        if (count == size) {
+            t_convolve_ir* grown = (t_convolve_ir*)realloc(*irs, sizeof(t_convolve_ir)*(size ? 2*size : 64));
+            if (!grown) break;
+            *irs = grown;
+            size = size ? 2*size : 64;
+        }
+
+        snprintf((*irs)[count].name, MAX_FILENAME_CHARS, "%s", name);
+        (*irs)[count].frames = wav.frames;
+        (*irs)[count].channels = wav.channels;
+        (*irs)[count].samples = NULL;
+        count++;
+    }
+
+    path_closefolder(state);
+    if (count) qsort(*irs, count, sizeof(t_convolve_ir), convolve_bank_compare);
+    return count;
+}
+
+int convolve_bank_compare(const void* a, const void* b) {
+    return strcmp(((const t_convolve_ir*)a)->name, ((const t_convolve_ir*)b)->name);
+}
+
+/* the loader thread: reads the impulse responses in order, staying at most `ahead` of the workers */
+void* convolve_bank_loader(t_convolve_bank* bank) {
+    for (long i = 0; i < bank->count; i++) {
+        t_convolve_ir* ir = bank->irs + i;
+        long scanned = ir->frames;  // fft_length only fits this many
+        double sample_rate = 0.;
+
+        systhread_mutex_lock(bank->mutex);
+        while (bank->loaded - bank->taken >= bank->ahead) systhread_cond_wait(bank->changed, bank->mutex);
+        systhread_mutex_unlock(bank->mutex);
+
+        ir->samples = wav_read(bank->folder, ir->name, &ir->frames, &ir->channels, &sample_rate);
+        if (!ir->samples) {
+            object_error((t_object*)bank->x, "could not load %s", ir->name);
+        } else if (ir->frames > scanned) {
+            object_error((t_object*)bank->x, "%s grew while the bank was running, skipping it", ir->name);
+            free(ir->samples);
+            ir->samples = NULL;
+        } else if (sample_rate != bank->sample_rate) {
+            object_warn((t_object*)bank->x, "%s and the signal have varying sample rates", ir->name);
+        }
+
+        systhread_mutex_lock(bank->mutex);
+        bank->loaded++;
+        systhread_cond_broadcast(bank->changed);
+        systhread_mutex_unlock(bank->mutex);
+    }
+
+    return NULL;
+}
+
+/* every worker takes the next loaded impulse response until there are none left (so which worker
+   this is, and how many there are, doesn't matter) */
+void convolve_bank_job(void* data, long index, long count) {
+    t_convolve_bank* bank = (t_convolve_bank*)data;
+    float* spectrum = (float*)malloc(sizeof(float)*bank->fft_length);
+    float* samples = (float*)malloc(sizeof(float)*bank->fft_length);
+
+    (void)index;
+    (void)count;
+
+    for (;;) {
+        t_convolve_ir* ir = NULL;
+
+        systhread_mutex_lock(bank->mutex);
+        while (bank->taken == bank->loaded && bank->taken < bank->count) systhread_cond_wait(bank->changed, bank->mutex);
+        if (bank->taken < bank->count) ir = bank->irs + bank->taken++;
+        systhread_cond_broadcast(bank->changed);
+        systhread_mutex_unlock(bank->mutex);
+
+        if (!ir) break;
+
+        /* (still taken, so the loader doesn't stall on a worker that ran out of memory) */
+        if (ir->samples && spectrum && samples) convolve_bank_render(bank, ir, spectrum, samples);
+        else if (ir->samples) object_error((t_object*)bank->x, "could not allocate memory for %s", ir->name);
+
+        free(ir->samples);
+        ir->samples = NULL;
+    }
 
-    /* free memory | unclaim buffers */
-    vDSP_destroy_fftsetup(setup);
     free(samples);
-    free(spectrum.imagp);
-    free(spectrum.realp);
+    free(spectrum);
+}
+
+/**
+ @method `convolve_bank_render`
+ one impulse response of the bank, convolved, normalized and written
+
+ - Parameters:
+    - spectrum, samples: `fft_length` floats of scratch each
+*/
+void convolve_bank_render(t_convolve_bank* bank, t_convolve_ir* ir, float* spectrum, float* samples) {
+    t_convolve* x = bank->x;
+    long conv_length = bank->length + ir->frames - 1;
+    long half = bank->fft_length/2;
+    long step1, step2;
+    long out_channels = convolve_pairing(x, bank->channels, ir->channels, &step1, &step2);
+    char filename[MAX_FILENAME_CHARS];
+    t_filehandle file;
+    float* result;
+
+    if (!out_channels) return;
+    if (!(result = (float*)malloc(sizeof(float)*conv_length*out_channels))) {
+        object_error((t_object*)x, "could not allocate memory for the output of %s", ir->name);
+        return;
+    }
+
+    for (long c = 0; c < out_channels; c++) {
+        t_fft_split h = {spectrum, spectrum + half};
+        t_fft_split signal = {bank->spectra + bank->fft_length*c*step1, bank->spectra + bank->fft_length*c*step1 + half};
+        const float* channel = ir->samples;
+
+        if (ir->channels > 1) {
+            for (long i = 0; i < ir->frames; i++) samples[i] = ir->samples[i*ir->channels + c*step2];
+            channel = samples;
+        }
+
+        memset(spectrum, 0, sizeof(float)*bank->fft_length);
+        fft_ctoz(channel, &h, ir->frames);
+
+        /* multiplied inside the inverse (see `convolve_fft`); only conv_length samples are needed */
+        if (fft_dft_execute_scrambled(bank->forward, &h, ir->frames) ||
+            fft_dft_execute_product_scrambled(bank->inverse, &signal, &h, &h, conv_length)) {
+            object_error((t_object*)x, "could not allocate memory for the FFT of %s", ir->name);
+            free(result);
+            return;
+        }
+        fft_ztoc(&h, samples, conv_length);
+
+        for (long i = 0; i < conv_length; i++) result[i*out_channels + c] = samples[i];
+    }
+
+    /* write to .WAV file */
+    convolve_normalize(result, conv_length*out_channels);
+    convolve_bank_filename(filename, bank, ir, ir - bank->irs + 1);
+
+    if (path_createsysfile(filename, bank->path, 'WAVE', &file)) {
+        object_error((t_object*)x, "could not create output file %s", filename);
+    } else {
+        write_wav(&file, conv_length, (unsigned int)out_channels, result, bank->sample_rate);
+        systhread_mutex_lock(bank->mutex);
+        bank->written++;
+        systhread_mutex_unlock(bank->mutex);
+    }
+
+    free(result);
+}
+
+/* the file for impulse response number `index`, from the template or the name chosen in the dialog */
+void convolve_bank_filename(char* filename, const t_convolve_bank* bank, const t_convolve_ir* ir, long index) {
+    char name[MAX_FILENAME_CHARS];
+    const char* dot = strrchr(ir->name, '.');
+    long length = 0;
+
+    /* the response's name without .wav */
+    snprintf(name, sizeof(name), "%.*s", dot ? (int)(dot - ir->name) : (int)strlen(ir->name), ir->name);
+
+    if (!bank->names) {
+        convolve_batch_filename(filename, bank->chosen, name);
+        return;
+    }
+
+    for (const char* t = bank->names->s_name; *t && length < MAX_FILENAME_CHARS - 1; t++) {
+        char* end = filename + length;
+        long room = MAX_FILENAME_CHARS - length;
+
+        if (t[0] == '%' && t[1] == 's') length += snprintf(end, room, "%s", name);
+        else if (t[0] == '%' && t[1] == 'd') length += snprintf(end, room, "%ld", index);
+        else if (t[0] == '%' && t[1] == '%') length += snprintf(end, room, "%%");
+        else {
+            filename[length++] = *t;
+            continue;
+        }
+        t++;
+    }
+
+    if (length > MAX_FILENAME_CHARS - 1) length = MAX_FILENAME_CHARS - 1;
+    filename[length] = 0;
+}
+
+void convolve_file_defer(t_convolve* x, t_symbol* sym, short argc, t_atom* argv) {
+    defer(x, (method)convolve_file, sym, argc, argv);
+}
+
+/**
+ @method `convolve_file`
+ `convolvefile IR_buffer [input.wav [output.wav]]`: a .wav file through the impulse response buffer,
+ for inputs too long for a buffer~. the input is read a block at a time into overlap-save engines
+ (one per output channel, paired up as in `convolve_pairing`) and the output written as it comes,
+ so only the impulse response and a few blocks are ever in memory. the output is normalized like
+ `convolve`'s, which takes a second pass: the samples first go to the output file as floats, then
+ are rewritten in place as 16-bit ones once the peak is known. (the file therefore needs twice its
+ final size on disk for a while.) without the file names, dialogs ask for them.
+*/
+void convolve_file(t_convolve* x, t_symbol* sym, short argc, t_atom* argv) {
+    char in_name[MAX_FILENAME_CHARS], out_name[MAX_FILENAME_CHARS];
+    short in_path, out_path;
+    t_fourcc filetype = 'WAVE', outtype;
+    t_filehandle in, out;
+    t_wav_reader wav;
+
+    if (argc < 1) {
+        object_error((t_object*)x, "usage: (convolvefile IR_buffer [input_file [output_file]])");
+        return;
+    } else if (x->pairing == gensym("matrix") || x->pairing == gensym("truestereo")) {
+        object_error((t_object*)x, "convolvefile can't use pairing %s", x->pairing->s_name);
+        return;
+    }
+
+    t_buffer_ref* ref = buffer_ref_new((t_object*)x, atom_getsym(argv));
+    t_buffer_obj* buffer = buffer_ref_getobject(ref);
+    long ir_length = (long)buffer_getframecount(buffer);
+    long ir_channels = (long)buffer_getchannelcount(buffer);
+
+    if (ir_length < 8) {
+        object_error((t_object*)x, "impulse response buffer %s is too short", atom_getsym(argv)->s_name);
+        object_free(ref);
+        return;
+    }
+
+    /* the input file */
+    if (argc > 1 ? path_frompathname(atom_getsym(argv + 1)->s_name, &in_path, in_name)
+                 : open_dialog(in_name, &in_path, &outtype, &filetype, 1)) {
+        if (argc > 1) object_error((t_object*)x, "could not find %s", atom_getsym(argv + 1)->s_name);
+        object_free(ref);
+        return;
+    } else if (path_opensysfile(in_name, in_path, &in, READ_PERM)) {
+        object_error((t_object*)x, "could not open %s", in_name);
+        object_free(ref);
+        return;
+    } else if (wav_reader_open(&wav, in) || wav.frames < 1) {
+        object_error((t_object*)x, "%s isn't a .wav file convolve can read", in_name);
+        sysfile_close(in);
+        object_free(ref);
+        return;
+    }
+
+    long step1, step2;
+    long out_channels = convolve_pairing(x, wav.channels, ir_channels, &step1, &step2);
+    long out_length = wav.frames + ir_length - 1;
+
+    /* the header can't describe more than 4 GB, and the first pass writes twice the final size to
+       the same file, so that has to fit too (this also keeps every sample count within a long) */
+    unsigned long long floats = (unsigned long long)out_length*(unsigned long long)out_channels;
+    if (CONVOLVE_WAV_HEADER + sizeof(float)*floats > CONVOLVE_WAV_MAX) {
+        object_error((t_object*)x, "the output of %s would need %.1f GB while it's written, more than a .wav file can hold (4 GB)",
+                     in_name, (double)(CONVOLVE_WAV_HEADER + sizeof(float)*floats)/1e9);
+        out_channels = 0;
+    }
+
+    t_conv_ols** engines = out_channels ? (t_conv_ols**)calloc(out_channels, sizeof(t_conv_ols*)) : NULL;
+    short failed = !engines;
+
+    if (out_channels && !engines) object_error((t_object*)x, "could not allocate memory for %ld channels", out_channels);
+
+    /* the output file */
+    if (!failed && (argc > 2 ? convolve_file_output(atom_getsym(argv + 2)->s_name, &out_path, out_name)
+                             : saveasdialog_extended(out_name, &out_path, &outtype, &filetype, 1))) {
+        if (argc > 2) object_error((t_object*)x, "could not find the folder of %s", atom_getsym(argv + 2)->s_name);
+        failed = 1;
+    }
+
+    /* the impulse response's partitions, transformed once per channel in use (the rest share them) */
+    if (!failed) {
+        float* samples = buffer_locksamples(buffer);
+        long block = conv_ols_block_size(ir_length);
+
+        for (long c = 0; !failed && c < out_channels; c++) {
+            float* ir;
+
+            if (c && !step2) {
+                engines[c] = conv_ols_clone(engines[0]);
+            } else if ((ir = convolve_deinterleave(x, samples, ir_length, ir_channels, c*step2))) {
+                engines[c] = conv_ols_new(ir, ir_length, block);
+                if (ir_channels > 1) free(ir);
+            }
+
+            failed = !engines[c];
+        }
+
+        buffer_unlocksamples(buffer);
+        if (failed) object_error((t_object*)x, "could not allocate memory for the convolution");
+    }
+
+    if (!failed && path_createsysfile(out_name, out_path, 'WAVE', &out)) {
+        object_error((t_object*)x, "could not create output file");
+        failed = 1;
+    }
+
+    /* first pass: the convolution, as floats after room for the header */
+    if (!failed) {
+        float peak = 0.f;
+
+        failed = convolve_file_stream(x, &wav, engines, out_channels, step1, out_length, out, &peak);
+        sysfile_close(out);
+
+        /* second pass: 16-bit samples, normalized (so the output doesn't clip and keeps its balance) */
+        if (!failed && path_opensysfile(out_name, out_path, &out, RW_PERM)) {
+            object_error((t_object*)x, "could not reopen %s", out_name);
+            failed = 1;
+        } else if (!failed) {
+            failed = convolve_file_finish(out, out_length*out_channels, peak > 0.f ? 1.f/peak : 1.f);
+            if (failed) object_error((t_object*)x, "could not write %s", out_name);
+
+            sysfile_setpos(out, SYSFILE_FROMSTART, 0);
+            write_wav_header(&out, out_length, (unsigned int)out_channels, (int)wav.sample_rate);
+            sysfile_seteof(out, (t_ptr_size)(CONVOLVE_WAV_HEADER + 2*floats));
+            sysfile_close(out);
+        }
+    }
+
+    for (long c = out_channels - 1; engines && c >= 0; c--) conv_ols_free(engines[c]);
+    free(engines);
+    sysfile_close(in);
+    object_free(ref);
+
+    /* bang! */
+    if (!failed && out_channels) outlet_bang(x->done);
+}
+
+/* the folder and name of an output file that may not exist yet (only its folder has to) */
+short convolve_file_output(const char* pathname, short* path, char* filename) {
+    char folder[MAX_PATH_CHARS], name[MAX_FILENAME_CHARS];
+    const char* slash = strrchr(pathname, '/');
+
+    if (!slash || !slash[1]) return 1;
+    snprintf(folder, sizeof(folder), "%.*s", (int)(slash - pathname), pathname);
+    if (path_frompathname(folder, path, name) || name[0]) return 1;
+
+    snprintf(filename, MAX_FILENAME_CHARS, "%s", slash + 1);
+    return 0;
+}
+
+/**
+ @method `convolve_file_stream`
+ `convolve_file`'s first pass: every block of the input through the engines, written to `out` as
+ interleaved float frames (after CONVOLVE_WAV_HEADER bytes)
+
+ - Parameter peak: set to the largest magnitude written
+ - Returns: 0 on success, 1 after posting an error
+*/
+short convolve_file_stream(t_convolve* x, t_wav_reader* wav, t_conv_ols** engines, long out_channels, long step1,
+                           long out_length, t_filehandle out, float* peak) {
+    long block = conv_ols_block(engines[0]);
+    long in_channels = wav->channels;
+    float* frames = (float*)malloc(sizeof(float)*block*(in_channels + out_channels));
+    float* results = frames + block*in_channels;
+    float* channel = (float*)malloc(sizeof(float)*2*block);
+    float* result = channel + block;
+    char header[CONVOLVE_WAV_HEADER] = {0};
+    t_ptr_size size = CONVOLVE_WAV_HEADER;
+    short failed = !frames || !channel;
+
+    if (failed) object_error((t_object*)x, "could not allocate memory for the convolution");
+    if (!failed) failed = sysfile_write(out, &size, header) != MAX_ERR_NONE;
+
+    for (long start = 0; !failed && start < out_length; start += block) {
+        long count = out_length - start < block ? out_length - start : block;
+
+        /* past the end of the input (or of a truncated file), the signal is silent */
+        long read = wav_reader_read(wav, frames, block);
+        memset(frames + read*in_channels, 0, sizeof(float)*(block - read)*in_channels);
+
+        for (long c = 0; c < out_channels; c++) {
+            for (long i = 0; i < block; i++) channel[i] = frames[i*in_channels + c*step1];
+            conv_ols_process(engines[c], channel, result);
+            for (long i = 0; i < block; i++) results[i*out_channels + c] = result[i];
+        }
+
+        for (long i = 0; i < count*out_channels; i++) {
+            if (fabsf(results[i]) > *peak) *peak = fabsf(results[i]);
+        }
+
+        size = sizeof(float)*count*out_channels;
+        failed = sysfile_write(out, &size, results) != MAX_ERR_NONE || size != sizeof(float)*count*out_channels;
+    }
+
+    if (failed && frames && channel) object_error((t_object*)x, "could not write the output file (is the disk full?)");
+
+    free(channel);
+    free(frames);
+    return failed;
+}
+
+/**
+ @method `convolve_file_finish`
+ `convolve_file`'s second pass: the `count` floats after the header, scaled by `gain` and rewritten
+ in place as the 16-bit samples `write_wav` writes. each sample takes half the room it had, so the
+ writes never catch up with the reads.
+
+ - Returns: 0 on success, 1 if the file couldn't be read or written
+*/
+short convolve_file_finish(t_filehandle file, long count, float gain) {
+    float floats[CONVOLVE_FILE_CHUNK];
+    unsigned char pcm[2*CONVOLVE_FILE_CHUNK];
+
+    for (long done = 0; done < count; done += CONVOLVE_FILE_CHUNK) {
+        long chunk = count - done < CONVOLVE_FILE_CHUNK ? count - done : CONVOLVE_FILE_CHUNK;
+        t_ptr_size size = sizeof(float)*chunk;
+
+        if (sysfile_setpos(file, SYSFILE_FROMSTART, CONVOLVE_WAV_HEADER + (t_ptr_int)sizeof(float)*done) ||
+            sysfile_read(file, &size, floats) || size != sizeof(float)*chunk) {
+            return 1;
+        }
+
+        for (long i = 0; i < chunk; i++) {
+            int word = (int)(floats[i]*gain*255);
+            pcm[2*i] = (unsigned char)(word & 0xff);
+            pcm[2*i + 1] = (unsigned char)((word >> 8) & 0xff);
+        }
+
+        size = 2*chunk;
+        if (sysfile_setpos(file, SYSFILE_FROMSTART, CONVOLVE_WAV_HEADER + (t_ptr_int)2*done) ||
+            sysfile_write(file, &size, pcm) || size != (t_ptr_size)(2*chunk)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ @method `convolve_channels`
+ every output channel convolves one channel of each buffer (see `convolve_pairing`)
+
+ - Parameters:
+    - samples1, samples2: the buffers' interleaved frames
+    - length1, length2: their frame counts
+    - channels1, channels2: their channel counts
+    - step1, step2: from `convolve_pairing`
+    - out_channels: number of output channels
+ - Returns: the length1 + length2 - 1 output frames, interleaved (free with `free`), or NULL after
+   posting an error
+*/
+float* convolve_channels(t_convolve* x, float* samples1, long length1, long channels1, long step1,
+                         float* samples2, long length2, long channels2, long step2, long out_channels) {
+    long conv_length = length1 + length2 - 1;
+
+    /* every channel has the same lengths, so one plan fits them all. the planner picks the cheapest
+       method for this job on this machine (see conv_plan.c) and the choice goes out the right outlet */
+    t_convolve_channels channels = {x, NULL, out_channels, length1, length2, {0}};
+    float* samples = NULL;
+    short failed = 0;
+
+    conv_plan(&channels.plan, length1 >= length2 ? length1 : length2, length1 >= length2 ? length2 : length1, 1, (long)x->latency);
+    convolve_report(x, &channels.plan);
+
+    /* contiguous copies of the channels in use (mono buffers are used as they are) */
+    channels.pairs = (t_convolve_pair*)calloc(out_channels, sizeof(t_convolve_pair));
+    if (!channels.pairs) {
+        object_error((t_object*)x, "could not allocate memory for %ld channels", out_channels);
+        return NULL;
+    }
+
+    for (long c = 0; !failed && c < out_channels; c++) {
+        t_convolve_pair* pair = channels.pairs + c;
+
+        pair->samples1 = c && !step1 ? channels.pairs[0].samples1 : convolve_deinterleave(x, samples1, length1, channels1, c*step1);
+        pair->samples2 = c && !step2 ? channels.pairs[0].samples2 : convolve_deinterleave(x, samples2, length2, channels2, c*step2);
+        failed = !pair->samples1 || !pair->samples2;
+    }
+
+    /* the channels are independent, so they run side by side on the workers. each one's transforms
+       then stay on its own worker (with a single channel, the transforms split up instead) */
+    if (!failed) {
+        long workers = fft_parallel_workers();
+        fft_parallel_run(convolve_channels_job, &channels, out_channels < workers ? out_channels : workers);
+    }
+
+    /* interleave the channels into frames */
+    if (!failed) {
+        for (long c = 0; c < out_channels; c++) failed |= !channels.pairs[c].result;
+        if (!failed) samples = (float*)malloc(sizeof(float)*conv_length*out_channels);
+        if (!failed && !samples) object_error((t_object*)x, "could not allocate memory for the output");
+    }
+    for (long c = 0; samples && c < out_channels; c++) {
+        const float* result = channels.pairs[c].result;
+        for (long i = 0; i < conv_length; i++) samples[i*out_channels + c] = result[i];
+    }
+
+    for (long c = 0; c < out_channels; c++) {
+        t_convolve_pair* pair = channels.pairs + c;
+        free(pair->result);
+        if (channels1 > 1 && (!c || step1)) free(pair->samples1);
+        if (channels2 > 1 && (!c || step2)) free(pair->samples2);
+    }
+    free(channels.pairs);
+
+    return samples;
+}
+
+/**
+ @method `convolve_matrix`
+ a convolution matrix: every output channel sums each input channel through its own impulse
+ response, as one transform (conv_matrix.c) or in partitions whose delay lines every output shares
+ (conv_mimo.c), whichever the planner finds cheaper
+
+ - Parameters:
+    - signal: interleaved frames of `inputs` channels
+    - signal_length: its frame count
+    - irs: interleaved frames of inputs*outputs channels, the response from input i to output o in
+      channel i*outputs + o (for true stereo: LL, LR, RL, RR)
+    - ir_length: its frame count
+ - Returns: same as `convolve_channels`
+*/
+float* convolve_matrix(t_convolve* x, float* signal, long signal_length, float* irs, long ir_length, long inputs, long outputs) {
+    long conv_length = signal_length + ir_length - 1;
+    long count = inputs + inputs*outputs + outputs;
+    float** channels = (float**)calloc(count, sizeof(float*));
+    float* samples = NULL;
+    t_conv_plan plan;
+    short failed = !channels;
+
+    if (failed) object_error((t_object*)x, "could not allocate memory for %ld channels", count);
+
+    conv_plan_matrix(&plan, signal_length, ir_length, inputs, outputs, (long)x->latency);
+    convolve_report(x, &plan);
+
+    /* the inputs, the impulse responses and the outputs, each contiguous */
+    for (long i = 0; !failed && i < inputs; i++) {
+        failed = !(channels[i] = convolve_deinterleave(x, signal, signal_length, inputs, i));
+    }
+    for (long i = 0; !failed && i < inputs*outputs; i++) {
+        failed = !(channels[inputs + i] = convolve_deinterleave(x, irs, ir_length, inputs*outputs, i));
+    }
+    for (long o = 0; !failed && o < outputs; o++) {
+        failed = !(channels[inputs + inputs*outputs + o] = (float*)malloc(sizeof(float)*conv_length));
+    }
+
+    if (!failed) {
+        const float* const* in = (const float* const*)channels;
+        const float* const* ir = (const float* const*)(channels + inputs);
+        float* const* out = channels + inputs + inputs*outputs;
+
+        if (plan.method == CONV_METHOD_OLS) {
+            t_conv_mimo* mimo = conv_mimo_new(ir, ir_length, inputs, outputs, plan.block);
+            if (mimo) conv_mimo_run(mimo, in, signal_length, out, conv_length);
+            else failed = 1;
+            conv_mimo_free(mimo);
+        } else {
+            failed = conv_matrix(in, inputs, signal_length, ir, ir_length, out, outputs, conv_length);
+        }
+
+        if (failed) object_error((t_object*)x, "could not allocate memory for the convolution");
+    }
+    if (!failed && !(samples = (float*)malloc(sizeof(float)*conv_length*outputs))) {
+        object_error((t_object*)x, "could not allocate memory for the output");
+    }
+
+    /* interleave the outputs into frames */
+    for (long o = 0; samples && o < outputs; o++) {
+        const float* result = channels[inputs + inputs*outputs + o];
+        for (long i = 0; i < conv_length; i++) samples[i*outputs + o] = result[i];
+    }
+
+    /* (a mono input is the buffer itself) */
+    for (long i = 0; channels && i < count; i++) {
+        if (i < inputs ? inputs > 1 : i < inputs + inputs*outputs ? inputs*outputs > 1 : 1) free(channels[i]);
+    }
+    free(channels);
+
+    return samples;
+}
+
+/* send the plan for a job out the right outlet: plan <method> <block or transform length> <seconds> */
+void convolve_report(t_convolve* x, const t_conv_plan* plan) {
+    t_atom report[3];
+
+    atom_setsym(report, gensym(conv_method_name(plan->method)));
+    atom_setlong(report + 1, plan->method == CONV_METHOD_FFT ? plan->length : plan->block);
+    atom_setfloat(report + 2, plan->seconds);
+    outlet_anything(x->info, gensym("plan"), 3, report);
+}
+
+/**
+ @method `convolve_pairing`
+ how the channels of the two inputs pair up, following the `pairing` attribute:
+
+    1toN    the first channel of buffer 1 with every channel of buffer 2 (e.g. a mono source
+            through a stereo or surround impulse response)
+    NtoN    channel c of buffer 1 with channel c of buffer 2
+    Nto1    every channel of buffer 1 with the first channel of buffer 2
+    auto    NtoN if the channel counts match, otherwise whichever of the others fits a mono buffer
+
+ (`truestereo` and `matrix` don't pair channels up, see `convolve_matrix`)
+
+ - Parameters:
+    - step1, step2: set to 1 if output channel c reads channel c of that buffer, 0 if it always
+      reads its first channel
+ - Returns: the number of output channels, or 0 after posting an error
+*/
+long convolve_pairing(t_convolve* x, long channels1, long channels2, long* step1, long* step2) {
+    t_symbol* pairing = x->pairing ? x->pairing : gensym("auto");
+
+    if (channels1 < 1) channels1 = 1;
+    if (channels2 < 1) channels2 = 1;
+
+    if (pairing == gensym("auto")) {
+        if (channels1 == channels2 || (channels1 > 1 && channels2 > 1)) pairing = gensym("NtoN");
+        else pairing = gensym(channels1 == 1 ? "1toN" : "Nto1");
+    }
+
+    if (pairing == gensym("1toN")) {
+        *step1 = 0;
+        *step2 = 1;
+        return channels2;
+    } else if (pairing == gensym("Nto1")) {
+        *step1 = 1;
+        *step2 = 0;
+        return channels1;
+    } else if (pairing == gensym("NtoN")) {
+        if (channels1 != channels2) {
+            object_warn((t_object*)x, "buffers have %ld and %ld channels, only convolving the first %ld",
+                        channels1, channels2, channels1 < channels2 ? channels1 : channels2);
+        }
+        *step1 = *step2 = 1;
+        return channels1 < channels2 ? channels1 : channels2;
+    }
+
+    object_error((t_object*)x, "unknown pairing %s (expected auto, 1toN, NtoN, Nto1, truestereo or matrix)", pairing->s_name);
+    return 0;
+}
+
+/**
+ @method `convolve_deinterleave`
+ one channel of a buffer's interleaved frames, as contiguous samples
+
+ - Returns: the samples themselves for a mono buffer, otherwise a copy (free with `free`), or NULL
+   after posting an error
+*/
+float* convolve_deinterleave(t_convolve* x, float* samples, long frames, long channels, long channel) {
+    float* out;
+
+    if (channels <= 1) return samples;
+
+    out = (float*)malloc(sizeof(float)*frames);
+    if (!out) {
+        object_error((t_object*)x, "could not allocate memory for channel %ld", channel + 1);
+        return NULL;
+    }
+
+    for (long i = 0; i < frames; i++) out[i] = samples[i*channels + channel];
+    return out;
+}
+
+/* worker `index` of `count` convolves channels index, index + count, ... */
+void convolve_channels_job(void* data, long index, long count) {
+    t_convolve_channels* channels = (t_convolve_channels*)data;
+
+    for (long c = index; c < channels->count; c += count) {
+        t_convolve_pair* pair = channels->pairs + c;
+        pair->result = convolve_pair(channels->x, &channels->plan, pair->samples1, channels->length1,
+                                     pair->samples2, channels->length2);
+    }
+}
+
+/**
+ @method `convolve_pair`
+ one channel's convolution, by the method in `plan`. the shorter input plays the impulse response.
+
+ - Returns: same as `convolve_fft`
+*/
+float* convolve_pair(t_convolve* x, const t_conv_plan* plan, float* samples1, long length1, float* samples2, long length2) {
+    float* signal = length1 >= length2 ? samples1 : samples2;
+    float* ir = length1 >= length2 ? samples2 : samples1;
+    long signal_length = length1 >= length2 ? length1 : length2;
+    long ir_length = length1 >= length2 ? length2 : length1;
+
+    switch (plan->method) {
+        case CONV_METHOD_DIRECT: return convolve_direct(x, signal, signal_length, ir, ir_length);
+        case CONV_METHOD_OLS: return convolve_ols(x, signal, signal_length, ir, ir_length, plan->block);
+        case CONV_METHOD_NUPOLS: return convolve_nupols(x, signal, signal_length, ir, ir_length, plan->block);
+    }
+
+    return convolve_fft(x, signal, signal_length, ir, ir_length);
+}
+
+/**
+ @method `convolve_fft`
+ the whole convolution as one transform: both signals are zero-padded to a length that holds the
+ result, transformed, multiplied and transformed back
+
+ - Returns: the length1 + length2 - 1 samples of the convolution (free with `free`), or NULL after
+   posting an error
+*/
+float* convolve_fft(t_convolve* x, float* samples1, long length1, float* samples2, long length2) {
+    long conv_length = length1 + length2 - 1;
+
+    /* cheapest transform length that holds the whole result (not necessarily a power of 2), or
+       just the result's length with the exact attribute */
+    long fft_length = x->exact ? fft_exact_size(conv_length) : fft_good_size(conv_length);
+
+    /* find spectrums of both signals */
+    t_fft_split spectrum1;  // input 1
+    t_fft_split spectrum2;  // input 2
+    init_spectrum(x, &spectrum1, fft_length, samples1, length1, 1);
+    init_spectrum(x, &spectrum2, fft_length, samples2, length2, 1);
+
+    /* pre-computed FFT bins (shared with every other convolve object) */
+    t_fft_dft_setup* forward = fft_cache_acquire(fft_length, FFT_FORWARD);
+    t_fft_dft_setup* inverse = fft_cache_acquire(fft_length, FFT_INVERSE);
+    float* samples = (float*)malloc(sizeof(float)*fft_length);
+
+    if (!forward || !inverse || !samples) {
+        object_error((t_object *) x, "could not pre-compute FFT bins");
+        free(samples);
+        samples = NULL;
+    } else {
+        /* compute FFT (both inputs are zero-padded to the full fft_length to avoid circular wrap-around;
+           the pruned transform skips the butterflies that would only see that padding). the bins are
+           only multiplied together, so they're left in whatever order is cheapest (see fft_zrip_scrambled) */
+        short failed = fft_dft_execute_scrambled(forward, &spectrum1, length1);
+        failed |= fft_dft_execute_scrambled(forward, &spectrum2, length2);
+
+        /* multiply both spectrums (time-domain convolution) and inverse DFT the product back to the
+           time-domain, into spectrum1. the multiplication happens inside the first stage of the
+           inverse, which also takes care of the nyquist bin packed into imagp[0]. only the first
+           conv_length samples are used, so the rest needn't be computed */
+        failed |= fft_dft_execute_product_scrambled(inverse, &spectrum1, &spectrum2, &spectrum1, conv_length);
+
+        /* unpack to output buffer */
+        if (failed) {
+            object_error((t_object *) x, "could not allocate memory for the FFT");
+            free(samples);
+            samples = NULL;
+        } else {
+            fft_ztoc(&spectrum1, samples, fft_length);
+        }
+    }
+
+    fft_cache_release(inverse);
+    fft_cache_release(forward);
     free(spectrum2.imagp);
     free(spectrum2.realp);
     free(spectrum1.imagp);
     free(spectrum1.realp);
-    buffer_unlocksamples(buffin2);
-    buffer_unlocksamples(buffin1);
 
-    /* bang! */
-    outlet_bang(x->done);
+    return samples;
+}
+
+/**
+ @method `convolve_direct`
+ the convolution with a short impulse response, one dot product per sample (see conv_fir.c)
+
+ - Returns: same as `convolve_fft`
+*/
+float* convolve_direct(t_convolve* x, float* signal, long signal_length, float* ir, long ir_length) {
+    long conv_length = signal_length + ir_length - 1;
+    float* samples = (float*)malloc(sizeof(float)*conv_length);
+
+    if (!samples) {
+        object_error((t_object*)x, "could not allocate memory for the convolution");
+        return NULL;
+    }
+
+    conv_direct(signal, signal_length, ir, ir_length, samples, conv_length);
+    return samples;
+}
+
+/**
+ @method `convolve_ols`
+ the convolution of a long signal with a shorter impulse response, one block at a time
+ (uniformly partitioned overlap-save, see conv_ols.c)
+
+ - Parameter block: partition length
+ - Returns: same as `convolve_fft`
+*/
+float* convolve_ols(t_convolve* x, float* signal, long signal_length, float* ir, long ir_length, long block) {
+    long conv_length = signal_length + ir_length - 1;
+    t_conv_ols* ols = conv_ols_new(ir, ir_length, block);
+    float* samples = (float*)malloc(sizeof(float)*conv_length);
+
+    if (!ols || !samples) {
+        object_error((t_object*)x, "could not allocate memory for the convolution");
+        free(samples);
+        conv_ols_free(ols);
+        return NULL;
+    }
+
+    /* the blocks are shared out between the workers in chunks */
+    conv_ols_run_parallel(ols, signal, signal_length, samples, conv_length);
+    conv_ols_free(ols);
+
+    return samples;
+}
+
+/**
+ @method `convolve_nupols`
+ `convolve_ols` with partitions growing from `block` samples along the impulse response, for a
+ long response under a short latency (see conv_nupols.c)
+*/
+float* convolve_nupols(t_convolve* x, float* signal, long signal_length, float* ir, long ir_length, long block) {
+    long conv_length = signal_length + ir_length - 1;
+    t_conv_nupols* nu = conv_nupols_new(ir, ir_length, block, 0);
+    float* samples = (float*)malloc(sizeof(float)*conv_length);
+
+    if (!nu || !samples) {
+        object_error((t_object*)x, "could not allocate memory for the convolution");
+        free(samples);
+        conv_nupols_free(nu);
+        return NULL;
+    }
+
+    conv_nupols_run(nu, signal, signal_length, samples, conv_length);
+    conv_nupols_free(nu);
+
+    return samples;
 }
 
 /**
  @method `init_spectrum`
- allocate spectrum memory, and pack samples into `DSPSplitComplex` format if `pack` is set
+ allocate spectrum memory, and pack samples into `t_fft_split` format if `pack` is set
 
  - Parameters:
     - x: object
@@ -212,7 +1707,7 @@ void convolve_main(t_convolve* x, t_symbol* sym, short argc, t_atom* argv) {
     - fft_length: length of the fft
     - pack: `1` to pack values into even-odd split format, `0` otherwise
 */
-void init_spectrum(t_convolve* x, DSPSplitComplex* spectrum, long fft_length, float* samples, long sig_length, short pack) {
+void init_spectrum(t_convolve* x, t_fft_split* spectrum, long fft_length, float* samples, long sig_length, short pack) {
     /* this should be freed at some point the caller method */
     spectrum->realp = (float*)malloc(sizeof(float)*fft_length/2);
     spectrum->imagp = (float*)malloc(sizeof(float)*fft_length/2);
@@ -222,37 +1717,19 @@ void init_spectrum(t_convolve* x, DSPSplitComplex* spectrum, long fft_length, fl
         return;
     }
 
-    /* vDSP data packing requires that the samples be stored as complex numbers
+    /* vDSP-style data packing requires that the samples be stored as complex numbers
        (e.g., [1, 2, 3, 4, ...] -> [(1 + j2), (3 + j4), ...]) */
     if (pack) {
-        vDSP_ctoz((DSPComplex*)samples, 2, spectrum, 1, (long)sig_length/2);
+        fft_ctoz(samples, spectrum, sig_length);
 
         /* pad remaining samples with zeroes */
-        for (uintptr_t i = sig_length/2; i < fft_length/2; i++) {
+        for (long i = (sig_length + 1)/2; i < fft_length/2; i++) {
             spectrum->realp[i] = 0.0;
             spectrum->imagp[i] = 0.0;
         }
     }
 }
 
-/**
- @method `get_log2n`
- rounds n to the next highest power of 2, and returns the base 2 log of that number
- (in other words, returns how many bits are necessary to store n)
-
- - Parameter n: any number
-*/
-short get_log2(long n) {
-    short log2n = 0;
-
-    while (n) {
-        n >>= 1;
-        log2n++;
-    }
-
-    return log2n;
-}
-
 /**
  the following two methods `write_little_endian` and `write_wav` are both slightly modified
  versions of Kevin Karplus' methods from `make_wav.c` to support Max formatting. check out his blog!
@@ -275,19 +1752,37 @@ void write_little_endian(t_filehandle* file, int num_bytes, int word) {
     }
 }
 
-void write_wav(t_filehandle* file, unsigned long num_samples, float * data, int s_rate) {
+void write_wav(t_filehandle* file, unsigned long num_samples, unsigned int num_channels, float * data, int s_rate) {
+    unsigned int bytes_per_sample = 2;
+    unsigned long i; // counter for samples
+
+    if (num_channels < 1) num_channels = 1;
+    write_wav_header(file, num_samples, num_channels, s_rate);
+
+    for (i = 0; i < num_samples*num_channels; i++) {                                    // interleaved frames
+        write_little_endian(file, bytes_per_sample, (int)(data[i]*255));                // samples written here
+    }
+
+    sysfile_close(*file);
+}
+
+/* the 44 bytes before the samples in `write_wav` (16-bit PCM). sizes past what the 32-bit fields
+   hold are written as 0xFFFFFFFF (which many readers take as "up to the end of the file") rather
+   than wrapping around; `convolve_file` turns those outputs down before it starts */
+void write_wav_header(t_filehandle* file, unsigned long num_samples, unsigned int num_channels, int s_rate) {
     unsigned int sample_rate;
-    unsigned int num_channels;
     unsigned int bytes_per_sample;
     unsigned int byte_rate;
-    unsigned long i; // counter for samples
+    unsigned long long data_size;
+    unsigned long long riff_size;
 
-    num_channels = 1;
+    if (num_channels < 1) num_channels = 1;
     bytes_per_sample = 2;
+    data_size = (unsigned long long)bytes_per_sample*num_samples*num_channels;
+    riff_size = 36 + data_size;
 
     /* sysfile_write asks for the number of bytes to be a pointer
        so it can overwrite with the actual number of bytes written */
-    t_ptr_size ptr2 = 2;
     t_ptr_size ptr4 = 4;
 
     if (s_rate<=0) sample_rate = 44100;
@@ -297,7 +1792,7 @@ void write_wav(t_filehandle* file, unsigned long num_samples, float * data, int
 
     /* write RIFF header */
     sysfile_write(*file, &ptr4, "RIFF");                                                // chunk id
-    write_little_endian(file, 4, (int)(36+bytes_per_sample*num_samples*num_channels));  // chunk size
+    write_little_endian(file, 4, (int)(riff_size < CONVOLVE_WAV_MAX ? riff_size : CONVOLVE_WAV_MAX));  // chunk size
     sysfile_write(*file, &ptr4, "WAVE");                                                // chunk format
 
     /* write fmt subchunk */
@@ -312,10 +1807,5 @@ void write_wav(t_filehandle* file, unsigned long num_samples, float * data, int
 
     /* write data subchunk */
     sysfile_write(*file, &ptr4, "data");                                                // subchunk id (data)
-    write_little_endian(file, 4, (int)(bytes_per_sample*num_samples*num_channels));     // subchunk size (data length)
-    for (i = 0; i < num_samples; i++) {
-        write_little_endian(file, bytes_per_sample, (int)(data[i]*255));                // samples written here
-    }
-
-    sysfile_close(*file);
+    write_little_endian(file, 4, (int)(data_size < CONVOLVE_WAV_MAX ? data_size : CONVOLVE_WAV_MAX));  // subchunk size (data length)
 }
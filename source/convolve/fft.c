@@ -0,0 +1,736 @@
+/**
+    @file fft - portable real-input FFT for convolve
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    the real transform of length n = 2m is computed the same way vDSP does it: the n real samples
+    are treated as m complex values, transformed with a complex FFT of length m, and then split
+    back into the spectrum of the real signal using its conjugate symmetry.
+
+    the complex FFT is an in-place radix-4 FFT (plus one radix-2 pass when log2(m) is odd) working
+    on split-complex data. the butterflies themselves are in fft_radix4.h, and fft_kernels.c picks
+    the widest instruction set the CPU supports.
+*/
+
+#include "fft.h"
+#include "fft_private.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct _fft_setup {
+    long    log2n;                      // largest real transform length this setup supports (log2)
+    float*  radix4[FFT_MAX_LOG2];       // radix-4 twiddles for complex blocks of length 2^i (see fft_dif4)
+    float*  real[FFT_MAX_LOG2];         // cos/sin(2*pi*k/n) for k <= n/4, for real transforms of length n = 2^i
+    float*  sixstep[FFT_MAX_LOG2];      // six-step twiddles for complex lengths 2^i (see fft_sixstep_twiddles)
+    float*  scrambled[FFT_MAX_LOG2];    // real split/merge twiddles in bit-reversed order (see fft_scrambled_twiddles)
+};
+
+#if defined(_MSC_VER)
+#define FFT_INLINE static __forceinline
+#else
+#define FFT_INLINE static inline __attribute__((always_inline))
+#endif
+
+static void fft_radix2(float* re, float* im, long m);
+
+/* six-step on a single thread: what the wisdom says, or past the cache threshold without any */
+FFT_INLINE short fft_prefer_sixstep(const t_fft_setup* setup, const long log2n) {
+    int strategy = fft_strategy(log2n);
+
+    if (!setup->sixstep[log2n - 1] || strategy == FFT_STRATEGY_RADIX4) return 0;
+    return strategy == FFT_STRATEGY_SIXSTEP || log2n >= fft_sixstep_log2n();
+}
+
+/* six-step is also the path that can use the workers, so it's taken from 2^FFT_PARALLEL_LOG2N up
+   whenever this call would get them. it doesn't pay when the runner is busy (or this thread is one
+   of its jobs): serially, it runs at about half the speed of radix-4 at those lengths */
+FFT_INLINE short fft_use_sixstep(const t_fft_setup* setup, const long log2n) {
+    if (fft_prefer_sixstep(setup, log2n)) return 1;
+    return setup->sixstep[log2n - 1] && fft_strategy(log2n) != FFT_STRATEGY_RADIX4 && log2n >= FFT_PARALLEL_LOG2N &&
+           fft_parallel_available();
+}
+
+/* the scrambled path skips bit reversal altogether, but leaves long transforms to the six-step path.
+   its bin order has to be the same for every transform whose spectra meet (a kernel transformed on
+   one thread and blocks on a worker, say), so it ignores the runner */
+FFT_INLINE short fft_use_scrambled(const t_fft_setup* setup, const long log2n) {
+    return setup->scrambled[log2n] && !fft_prefer_sixstep(setup, log2n);
+}
+
+FFT_INLINE void fft_zrip_forward(const t_fft_setup* setup, float* re, float* im, const long log2n) {
+    if (!fft_use_sixstep(setup, log2n) ||
+        fft_sixstep_complex(setup, setup->sixstep[log2n - 1], re, im, log2n - 1, FFT_FORWARD)) {
+        fft_complex_forward(setup, re, im, log2n - 1);
+        fft_bitreverse(re, im, log2n - 1);
+    }
+    fft_real_split(re, im, 1L << (log2n - 1), setup->real[log2n]);
+}
+
+/* everything after the real merge (the complex inverse FFT in natural order) */
+FFT_INLINE void fft_zrip_inverse_complex(const t_fft_setup* setup, float* re, float* im, const long log2n) {
+    if (!fft_use_sixstep(setup, log2n) ||
+        fft_sixstep_complex(setup, setup->sixstep[log2n - 1], re, im, log2n - 1, FFT_INVERSE)) {
+        fft_bitreverse(re, im, log2n - 1);
+        fft_complex_inverse(setup, re, im, log2n - 1);
+    }
+}
+
+FFT_INLINE void fft_zrip_inverse(const t_fft_setup* setup, float* re, float* im, const long log2n) {
+    fft_real_merge(re, im, 1L << (log2n - 1), setup->real[log2n]);
+    fft_zrip_inverse_complex(setup, re, im, log2n);
+}
+
+/**
+ @method `fft_setup_new`
+ precompute the twiddle factors for real transforms of length up to 2^log2n. as with vDSP, one
+ setup can be used for any smaller transform as well.
+
+ - Parameter log2n: base 2 log of the largest real transform length
+ - Returns: the setup, or NULL if it couldn't be allocated
+*/
+t_fft_setup* fft_setup_new(long log2n) {
+    t_fft_setup* setup;
+
+    if (log2n < 1 || log2n >= FFT_MAX_LOG2) return NULL;
+
+    setup = (t_fft_setup*)calloc(1, sizeof(t_fft_setup));
+    if (!setup) return NULL;
+    setup->log2n = log2n;
+
+    /* complex blocks run up to half the real length */
+    for (long l2 = 2; l2 <= log2n - 1; l2++) {
+        long len = 1L << l2;
+        long q = len >> 2;
+        float* tw = (float*)malloc(sizeof(float)*6*q);
+
+        if (!tw) {
+            fft_setup_free(setup);
+            return NULL;
+        }
+
+        for (long j = 0; j < q; j++) {
+            for (long k = 1; k <= 3; k++) {
+                double angle = -2.0*FFT_PI*(double)(j*k)/(double)len;
+                tw[(2*k - 2)*q + j] = (float)cos(angle);
+                tw[(2*k - 1)*q + j] = (float)sin(angle);
+            }
+        }
+        setup->radix4[l2] = tw;
+
+        if (l2 >= FFT_SIXSTEP_MIN_LOG2M && !(setup->sixstep[l2] = fft_sixstep_twiddles(l2))) {
+            fft_setup_free(setup);
+            return NULL;
+        }
+    }
+
+    for (long l2 = 1; l2 <= log2n; l2++) {
+        setup->real[l2] = fft_real_twiddles(1L << l2);
+
+        if (!setup->real[l2]) {
+            fft_setup_free(setup);
+            return NULL;
+        }
+
+        if (l2 >= FFT_SCRAMBLED_MIN_LOG2N && l2 <= FFT_SCRAMBLED_MAX_LOG2N &&
+            !(setup->scrambled[l2] = fft_scrambled_twiddles(l2))) {
+            fft_setup_free(setup);
+            return NULL;
+        }
+    }
+
+    return setup;
+}
+
+void fft_setup_free(t_fft_setup* setup) {
+    if (!setup) return;
+
+    for (long i = 0; i < FFT_MAX_LOG2; i++) {
+        free(setup->radix4[i]);
+        free(setup->real[i]);
+        free(setup->sixstep[i]);
+        free(setup->scrambled[i]);
+    }
+    free(setup);
+}
+
+long fft_setup_log2n(const t_fft_setup* setup) {
+    return setup ? setup->log2n : 0;
+}
+
+/**
+ @method `fft_zrip`
+ in-place real FFT on packed split-complex data (drop-in for `vDSP_fft_zrip` with unit stride).
+
+ forward: `spectrum` holds the n samples packed even/odd (see `fft_ctoz`) and is replaced by
+ 2x the first n/2 bins of the DFT, with the (real) nyquist bin stored in `imagp[0]`.
+ inverse: takes a spectrum in that format and returns the packed samples scaled by n, so a
+ forward/inverse round trip scales the signal by 2n.
+
+ - Parameters:
+    - setup: twiddle factors from `fft_setup_new` (log2n of the setup must be >= log2n)
+    - spectrum: n/2 complex values, transformed in place
+    - log2n: base 2 log of the real transform length n
+    - direction: `FFT_FORWARD` or `FFT_INVERSE`
+*/
+void fft_zrip(const t_fft_setup* setup, t_fft_split* spectrum, long log2n, int direction) {
+    if (!setup || log2n < 1 || log2n > setup->log2n) return;
+
+    if (direction == FFT_FORWARD) {
+        fft_zrip_forward(setup, spectrum->realp, spectrum->imagp, log2n);
+    } else {
+        fft_zrip_inverse(setup, spectrum->realp, spectrum->imagp, log2n);
+    }
+}
+
+/**
+ @method `fft_zrip_pruned`
+ `fft_zrip` for zero-padded input or partly needed output. the butterflies that would only
+ read known zeros (forward) or only produce unwanted samples (inverse) are skipped.
+
+ - Parameters: same as `fft_zrip`, plus
+    - length: forward: number of leading samples that may be nonzero (the rest must be zero).
+      inverse: number of leading samples needed (the rest of the output is undefined).
+*/
+void fft_zrip_pruned(const t_fft_setup* setup, t_fft_split* spectrum, long log2n, int direction, long length) {
+    long m = 1L << (log2n - 1);
+    long count = (length + 1)/2;
+
+    if (!setup || log2n < 1 || log2n > setup->log2n) return;
+
+    /* pruning only pays off once at least one whole pass can be skipped */
+    if (log2n < 4 || count > m/4) {
+        fft_zrip(setup, spectrum, log2n, direction);
+    } else if (direction == FFT_FORWARD) {
+        fft_complex_forward_pruned(setup, spectrum->realp, spectrum->imagp, log2n - 1, count);
+        fft_bitreverse(spectrum->realp, spectrum->imagp, log2n - 1);
+        fft_real_split(spectrum->realp, spectrum->imagp, m, setup->real[log2n]);
+    } else {
+        fft_real_merge(spectrum->realp, spectrum->imagp, m, setup->real[log2n]);
+        fft_bitreverse(spectrum->realp, spectrum->imagp, log2n - 1);
+        fft_complex_inverse_pruned(setup, spectrum->realp, spectrum->imagp, log2n - 1, count);
+    }
+}
+
+/**
+ @method `fft_zrip_product`
+ inverse `fft_zrip` of the product of two packed spectra: what `fft_zvmul` followed by an inverse
+ `fft_zrip` computes, except that dc and nyquist (packed into bin 0) are multiplied separately.
+ the product is formed inside the first stage of the inverse (the real merge), so it's never
+ written out and read back on its own.
+
+ - Parameters:
+    - setup: twiddle factors from `fft_setup_new`
+    - a, b: spectra from forward transforms of length 2^log2n
+    - out: the packed samples, scaled like `fft_zrip` (may alias `a` or `b`)
+    - log2n: base 2 log of the real transform length n
+    - length: number of leading samples needed (as in `fft_zrip_pruned`), or n for all of them
+*/
+void fft_zrip_product(const t_fft_setup* setup, const t_fft_split* a, const t_fft_split* b, t_fft_split* out, long log2n, long length) {
+    long m = 1L << (log2n - 1);
+    long count = (length + 1)/2;
+
+    if (!setup || log2n < 1 || log2n > setup->log2n) return;
+
+    fft_real_merge_product(a->realp, a->imagp, b->realp, b->imagp, out->realp, out->imagp, m, setup->real[log2n]);
+
+    if (log2n >= 4 && count <= m/4) {
+        fft_bitreverse(out->realp, out->imagp, log2n - 1);
+        fft_complex_inverse_pruned(setup, out->realp, out->imagp, log2n - 1, count);
+    } else {
+        fft_zrip_inverse_complex(setup, out->realp, out->imagp, log2n);
+    }
+}
+
+/**
+ @method `fft_zrip_scrambled`
+ forward `fft_zrip` that leaves the bins in whatever order is cheapest to produce, for spectra that
+ are only ever multiplied together and handed to `fft_zrip_product_scrambled`. below the six-step
+ threshold that's bit-reversed order, which saves both bit-reversal passes of a convolution; the
+ packing of dc and nyquist into bin 0 is the same as `fft_zrip`.
+
+ - Parameters: same as the forward `fft_zrip_pruned`
+*/
+void fft_zrip_scrambled(const t_fft_setup* setup, t_fft_split* spectrum, long log2n, long length) {
+    if (!setup || log2n < 1 || log2n > setup->log2n) return;
+
+    if (!fft_use_scrambled(setup, log2n)) {
+        fft_zrip_pruned(setup, spectrum, log2n, FFT_FORWARD, length);
+        return;
+    }
+
+    fft_complex_forward_pruned(setup, spectrum->realp, spectrum->imagp, log2n - 1, (length + 1)/2);
+    fft_real_split_scrambled(spectrum->realp, spectrum->imagp, 1L << (log2n - 1), setup->scrambled[log2n]);
+}
+
+/**
+ @method `fft_zrip_product_scrambled`
+ `fft_zrip_product` for two spectra from `fft_zrip_scrambled` (the output is in natural order).
+ the forward and inverse transforms must be run with the same six-step threshold and wisdom, since
+ those decide the bin order.
+*/
+void fft_zrip_product_scrambled(const t_fft_setup* setup, const t_fft_split* a, const t_fft_split* b, t_fft_split* out, long log2n, long length) {
+    if (!setup || log2n < 1 || log2n > setup->log2n) return;
+
+    if (!fft_use_scrambled(setup, log2n)) {
+        fft_zrip_product(setup, a, b, out, log2n, length);
+        return;
+    }
+
+    fft_real_merge_product_scrambled(a->realp, a->imagp, b->realp, b->imagp, out->realp, out->imagp, 1L << (log2n - 1), setup->scrambled[log2n]);
+    fft_complex_inverse_pruned(setup, out->realp, out->imagp, log2n - 1, (length + 1)/2);
+}
+
+/**
+ @method `fft_zrip_inverse_scrambled`
+ inverse `fft_zrip_pruned` of a spectrum in the order `fft_zrip_scrambled` leaves it, e.g. a sum of
+ products of such spectra (the output is in natural order)
+*/
+void fft_zrip_inverse_scrambled(const t_fft_setup* setup, t_fft_split* spectrum, long log2n, long length) {
+    if (!setup || log2n < 1 || log2n > setup->log2n) return;
+
+    if (!fft_use_scrambled(setup, log2n)) {
+        fft_zrip_pruned(setup, spectrum, log2n, FFT_INVERSE, length);
+        return;
+    }
+
+    fft_real_merge_scrambled(spectrum->realp, spectrum->imagp, 1L << (log2n - 1), setup->scrambled[log2n]);
+    fft_complex_inverse_pruned(setup, spectrum->realp, spectrum->imagp, log2n - 1, (length + 1)/2);
+}
+
+/**
+ @method `fft_zvmul`
+ multiply two split-complex vectors of length n element by element (`out` may alias `a` or `b`)
+*/
+void fft_zvmul(const t_fft_split* a, const t_fft_split* b, t_fft_split* out, long n) {
+    fft_kernels->zvmul(a->realp, a->imagp, b->realp, b->imagp, out->realp, out->imagp, n);
+}
+
+/**
+ @method `fft_zvma`
+ multiply two split-complex vectors of length n element by element and add a third (`vDSP_zvma`):
+ out = a*b + c (`out` may alias `c`)
+*/
+void fft_zvma(const t_fft_split* a, const t_fft_split* b, const t_fft_split* c, t_fft_split* out, long n) {
+    fft_kernels->zvma(a->realp, a->imagp, b->realp, b->imagp, c->realp, c->imagp, out->realp, out->imagp, n);
+}
+
+/**
+ @method `fft_ctoz`
+ pack n real samples into n/2 split-complex values ([1, 2, 3, 4] -> realp: [1, 3], imagp: [2, 4]).
+ an odd trailing sample is packed with a zero in its imaginary half.
+*/
+void fft_ctoz(const float* samples, t_fft_split* spectrum, long n) {
+    long half = n/2;
+
+    for (long i = 0; i < half; i++) {
+        spectrum->realp[i] = samples[2*i];
+        spectrum->imagp[i] = samples[2*i + 1];
+    }
+
+    if (n & 1) {
+        spectrum->realp[half] = samples[n - 1];
+        spectrum->imagp[half] = 0.f;
+    }
+}
+
+/**
+ @method `fft_ztoc`
+ unpack n/2 split-complex values back into n interleaved real samples (inverse of `fft_ctoz`)
+*/
+void fft_ztoc(const t_fft_split* spectrum, float* samples, long n) {
+    long half = n/2;
+
+    for (long i = 0; i < half; i++) {
+        samples[2*i] = spectrum->realp[i];
+        samples[2*i + 1] = spectrum->imagp[i];
+    }
+
+    if (n & 1) samples[n - 1] = spectrum->realp[half];
+}
+
+void fft_vsmul(float* samples, float scale, long n) {
+    for (long i = 0; i < n; i++) samples[i] *= scale;
+}
+
+/* internal transforms */
+
+/* the twiddle tables, for the passes outside this file (see fft_batch.c) */
+const float* fft_setup_radix4(const t_fft_setup* setup, long log2m) {
+    return setup->radix4[log2m];
+}
+
+const float* fft_setup_real(const t_fft_setup* setup, long log2n) {
+    return setup->real[log2n];
+}
+
+/* radix-4 passes down to blocks of 16 (or 8, when log2(m) is odd) points, then the codelets */
+void fft_complex_forward(const t_fft_setup* setup, float* re, float* im, long log2m) {
+    long m = 1L << log2m;
+    long leaf = (log2m & 1) ? 3 : 4;
+    long l2;
+
+    if (log2m < 3) {
+        if (log2m == 2) fft_kernels_scalar_dif4(re, im, m, 1, setup->radix4[2]);
+        if (log2m == 1) fft_radix2(re, im, m);
+        return;
+    }
+
+    for (l2 = log2m; l2 > leaf; l2 -= 2) {
+        long q = 1L << (l2 - 2);
+        const t_fft_kernels* k = fft_kernels_for(q);
+        k->dif4(re, im, m, q, setup->radix4[l2]);
+    }
+
+    if (leaf == 4) fft_codelet_dif16(re, im, m);
+    else fft_codelet_dif8(re, im, m);
+}
+
+void fft_complex_inverse(const t_fft_setup* setup, float* re, float* im, long log2m) {
+    long m = 1L << log2m;
+    long leaf = (log2m & 1) ? 3 : 4;
+
+    if (log2m < 3) {
+        if (log2m == 2) fft_kernels_scalar_dit4(re, im, m, 1, setup->radix4[2]);
+        if (log2m == 1) fft_radix2(re, im, m);
+        return;
+    }
+
+    if (leaf == 4) fft_codelet_dit16(re, im, m);
+    else fft_codelet_dit8(re, im, m);
+
+    for (long l2 = leaf + 2; l2 <= log2m; l2 += 2) {
+        long q = 1L << (l2 - 2);
+        const t_fft_kernels* k = fft_kernels_for(q);
+        k->dit4(re, im, m, q, setup->radix4[l2]);
+    }
+}
+
+/* `fft_complex_forward` when only the first `count` points can be nonzero: the passes whose
+   quarter length covers them just spread them out with twiddles (see fft_dif4_pruned) */
+void fft_complex_forward_pruned(const t_fft_setup* setup, float* re, float* im, long log2m, long count) {
+    long m = 1L << log2m;
+    long leaf = (log2m & 1) ? 3 : 4;
+    long l2;
+
+    if (log2m < 3) {
+        fft_complex_forward(setup, re, im, log2m);
+        return;
+    }
+
+    for (l2 = log2m; l2 > leaf; l2 -= 2) {
+        long q = 1L << (l2 - 2);
+        const t_fft_kernels* k = fft_kernels_for(q);
+        long c = (count + k->width - 1)/k->width*k->width;
+
+        if (c <= q) k->dif4_pruned(re, im, m, q, c, setup->radix4[l2]);
+        else k->dif4(re, im, m, q, setup->radix4[l2]);
+    }
+
+    if (leaf == 4) fft_codelet_dif16(re, im, m);
+    else fft_codelet_dif8(re, im, m);
+}
+
+/* `fft_complex_inverse` when only the first `count` outputs are needed (the rest are garbage) */
+void fft_complex_inverse_pruned(const t_fft_setup* setup, float* re, float* im, long log2m, long count) {
+    long m = 1L << log2m;
+    long leaf = (log2m & 1) ? 3 : 4;
+
+    if (log2m < 3) {
+        fft_complex_inverse(setup, re, im, log2m);
+        return;
+    }
+
+    if (leaf == 4) fft_codelet_dit16(re, im, m);
+    else fft_codelet_dit8(re, im, m);
+
+    for (long l2 = leaf + 2; l2 <= log2m; l2 += 2) {
+        long q = 1L << (l2 - 2);
+        const t_fft_kernels* k = fft_kernels_for(q);
+        long c = (count + k->width - 1)/k->width*k->width;
+
+        if (c <= q) k->dit4_pruned(re, im, m, q, c, setup->radix4[l2]);
+        else k->dit4(re, im, m, q, setup->radix4[l2]);
+    }
+}
+
+/* length-2 butterflies (no twiddles), used when log2(m) is odd */
+static void fft_radix2(float* re, float* im, long m) {
+    for (long b = 0; b < m; b += 2) {
+        float ar = re[b], ai = im[b];
+        float br = re[b + 1], bi = im[b + 1];
+        re[b] = ar + br; im[b] = ai + bi;
+        re[b + 1] = ar - br; im[b + 1] = ai - bi;
+    }
+}
+
+void fft_bitreverse(float* re, float* im, long log2m) {
+    unsigned long m = 1UL << log2m;
+    unsigned long j = 0;
+
+    if (log2m < 2) return;
+
+    for (unsigned long i = 1; i < m - 1; i++) {
+        /* j = reverse(i), kept up to date by adding 1 from the top bit down */
+        unsigned long bit = m >> 1;
+        while (j & bit) {
+            j ^= bit;
+            bit >>= 1;
+        }
+        j |= bit;
+
+        if (i < j) {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+}
+
+/**
+ @method `fft_real_split`
+ turn the length m = n/2 complex FFT z of the packed samples into the packed real spectrum:
+    2X[k] = (z[k] + conj(z[m-k])) - i*w^k*(z[k] - conj(z[m-k])),  w = exp(-2*pi*i/n)
+ bins k and m-k are computed together since they share every term. works for any m (odd too).
+
+ - Parameters:
+    - re, im: the m complex values, replaced by the packed spectrum
+    - m: half the real transform length
+    - tw: cos(2*pi*k/n) for k <= m/2, followed by sin(2*pi*k/n) for the same k
+*/
+void fft_real_split(float* re, float* im, long m, const float* tw) {
+    const float* cosine = tw;
+    const float* sine = tw + m/2 + 1;
+
+    /* dc and nyquist are both real, and share the first complex value */
+    float z0r = re[0], z0i = im[0];
+    re[0] = 2.f*(z0r + z0i);
+    im[0] = 2.f*(z0r - z0i);
+
+    for (long k = 1; k <= m/2; k++) {
+        long j = m - k;
+        float c = cosine[k], s = sine[k];
+
+        float er = re[k] + re[j], ei = im[k] - im[j];   // z[k] + conj(z[m-k])
+        float dr = re[k] - re[j], di = im[k] + im[j];   // z[k] - conj(z[m-k])
+
+        float tr = c*di - s*dr;                         // -i*w^k*d
+        float ti = -c*dr - s*di;
+
+        re[k] = er + tr; im[k] = ei + ti;
+        re[j] = er - tr; im[j] = ti - ei;
+    }
+}
+
+/**
+ @method `fft_real_merge`
+ undo `fft_real_split`, producing 2z from a packed real spectrum X:
+    2z[k] = (X[k] + conj(X[m-k])) + i*w^-k*(X[k] - conj(X[m-k]))
+
+ - Parameters: same as `fft_real_split`
+*/
+void fft_real_merge(float* re, float* im, long m, const float* tw) {
+    const float* cosine = tw;
+    const float* sine = tw + m/2 + 1;
+
+    float dc = re[0], nyq = im[0];
+    re[0] = dc + nyq;
+    im[0] = dc - nyq;
+
+    for (long k = 1; k <= m/2; k++) {
+        long j = m - k;
+        float c = cosine[k], s = sine[k];
+
+        float er = re[k] + re[j], ei = im[k] - im[j];   // X[k] + conj(X[m-k])
+        float dr = re[k] - re[j], di = im[k] + im[j];   // X[k] - conj(X[m-k])
+
+        float ur = -s*dr - c*di;                        // i*w^-k*d
+        float ui = c*dr - s*di;
+
+        re[k] = er + ur; im[k] = ei + ui;
+        re[j] = er - ur; im[j] = ui - ei;
+    }
+}
+
+/**
+ @method `fft_real_merge_product`
+ `fft_real_merge` of the bin-by-bin product of two packed spectra a and b, written to `re`/`im`
+ (which may alias either input). bins k and m - k are only read by the iteration that writes them.
+
+ - Parameters: the two spectra, the output, and the rest as in `fft_real_split`
+*/
+void fft_real_merge_product(const float* ar, const float* ai, const float* br, const float* bi, float* re, float* im, long m, const float* tw) {
+    const float* cosine = tw;
+    const float* sine = tw + m/2 + 1;
+
+    float dc = ar[0]*br[0], nyq = ai[0]*bi[0];
+    re[0] = dc + nyq;
+    im[0] = dc - nyq;
+
+    for (long k = 1; k <= m/2; k++) {
+        long j = m - k;
+        float c = cosine[k], s = sine[k];
+
+        float xr = ar[k]*br[k] - ai[k]*bi[k], xi = ar[k]*bi[k] + ai[k]*br[k];   // X[k]
+        float yr = ar[j]*br[j] - ai[j]*bi[j], yi = ar[j]*bi[j] + ai[j]*br[j];   // X[m-k]
+
+        float er = xr + yr, ei = xi - yi;
+        float dr = xr - yr, di = xi + yi;
+
+        float ur = -s*dr - c*di;
+        float ui = c*dr - s*di;
+
+        re[k] = er + ur; im[k] = ei + ui;
+        re[j] = er - ur; im[j] = ui - ei;
+    }
+}
+
+/**
+ @method `fft_real_split_scrambled`
+ `fft_real_split` on bit-reversed data, leaving the spectrum bit-reversed as well. bin k = rev(p)
+ sits at position p, and its partner m - k at the mirror image of p within the same octave
+ [b, 2b): negating an odd multiple of a power of two flips every bit above the lowest set one,
+ which in reversed order are the bits below b. so the pairs are (b + t, 2b - 1 - t).
+
+ - Parameters:
+    - re, im: the m complex values in bit-reversed order, replaced by the packed spectrum
+    - m: half the real transform length (a power of two)
+    - tw: from `fft_scrambled_twiddles`
+*/
+void fft_real_split_scrambled(float* re, float* im, long m, const float* tw) {
+    const float* cosine = tw;
+    const float* sine = tw + m/2;
+
+    float z0r = re[0], z0i = im[0];
+    re[0] = 2.f*(z0r + z0i);
+    im[0] = 2.f*(z0r - z0i);
+
+    /* octave 1 (p = 1) holds bin m/2, which is its own partner */
+    for (long b = 1; b < m; b *= 2) {
+        for (long t = 0; t < (b + 1)/2; t++) {
+            long k = b + t, j = 2*b - 1 - t;
+            float c = cosine[b/2 + t], s = sine[b/2 + t];
+
+            float er = re[k] + re[j], ei = im[k] - im[j];
+            float dr = re[k] - re[j], di = im[k] + im[j];
+
+            float tr = c*di - s*dr;
+            float ti = -c*dr - s*di;
+
+            re[k] = er + tr; im[k] = ei + ti;
+            re[j] = er - tr; im[j] = ti - ei;
+        }
+    }
+}
+
+/**
+ @method `fft_real_merge_scrambled`
+ `fft_real_merge` on a bit-reversed spectrum (see `fft_real_split_scrambled`), leaving the result
+ in bit-reversed order for `fft_complex_inverse`
+*/
+void fft_real_merge_scrambled(float* re, float* im, long m, const float* tw) {
+    const float* cosine = tw;
+    const float* sine = tw + m/2;
+
+    float dc = re[0], nyq = im[0];
+    re[0] = dc + nyq;
+    im[0] = dc - nyq;
+
+    for (long b = 1; b < m; b *= 2) {
+        for (long t = 0; t < (b + 1)/2; t++) {
+            long k = b + t, j = 2*b - 1 - t;
+            float c = cosine[b/2 + t], s = sine[b/2 + t];
+
+            float er = re[k] + re[j], ei = im[k] - im[j];
+            float dr = re[k] - re[j], di = im[k] + im[j];
+
+            float ur = -s*dr - c*di;
+            float ui = c*dr - s*di;
+
+            re[k] = er + ur; im[k] = ei + ui;
+            re[j] = er - ur; im[j] = ui - ei;
+        }
+    }
+}
+
+/**
+ @method `fft_real_merge_product_scrambled`
+ `fft_real_merge_product` on bit-reversed spectra (see `fft_real_split_scrambled`), leaving the
+ result in bit-reversed order for `fft_complex_inverse`
+*/
+void fft_real_merge_product_scrambled(const float* ar, const float* ai, const float* br, const float* bi, float* re, float* im, long m, const float* tw) {
+    const float* cosine = tw;
+    const float* sine = tw + m/2;
+
+    float dc = ar[0]*br[0], nyq = ai[0]*bi[0];
+    re[0] = dc + nyq;
+    im[0] = dc - nyq;
+
+    for (long b = 1; b < m; b *= 2) {
+        for (long t = 0; t < (b + 1)/2; t++) {
+            long k = b + t, j = 2*b - 1 - t;
+            float c = cosine[b/2 + t], s = sine[b/2 + t];
+
+            float xr = ar[k]*br[k] - ai[k]*bi[k], xi = ar[k]*bi[k] + ai[k]*br[k];
+            float yr = ar[j]*br[j] - ai[j]*bi[j], yi = ar[j]*bi[j] + ai[j]*br[j];
+
+            float er = xr + yr, ei = xi - yi;
+            float dr = xr - yr, di = xi + yi;
+
+            float ur = -s*dr - c*di;
+            float ui = c*dr - s*di;
+
+            re[k] = er + ur; im[k] = ei + ui;
+            re[j] = er - ur; im[j] = ui - ei;
+        }
+    }
+}
+
+/**
+ @method `fft_scrambled_twiddles`
+ allocate the table for `fft_real_split_scrambled` for a real length n = 2^log2n: cos/sin of
+ 2*pi*rev(p)/n for the first half of every octave of positions p, stored contiguously (entry
+ b/2 + t for p = b + t) so that the split reads it front to back
+
+ - Returns: the table (free with `free`), or NULL if it couldn't be allocated
+*/
+float* fft_scrambled_twiddles(long log2n) {
+    long log2m = log2n - 1;
+    long half = 1L << (log2m - 1);
+    float* tw = (float*)malloc(sizeof(float)*2*half);
+
+    if (!tw) return NULL;
+
+    for (long b = 1; b < 2*half; b *= 2) {
+        for (long t = 0; t < (b + 1)/2; t++) {
+            long p = b + t, k = 0;
+            for (long bit = 0; bit < log2m; bit++) k |= ((p >> bit) & 1) << (log2m - 1 - bit);
+
+            double angle = 2.0*FFT_PI*(double)k/(double)(1L << log2n);
+            tw[b/2 + t] = (float)cos(angle);
+            tw[half + b/2 + t] = (float)sin(angle);
+        }
+    }
+
+    return tw;
+}
+
+/**
+ @method `fft_real_twiddles`
+ allocate the cos/sin table used by `fft_real_split` and `fft_real_merge` for a real length n
+
+ - Returns: the table (free with `free`), or NULL if it couldn't be allocated
+*/
+float* fft_real_twiddles(long n) {
+    long count = n/4 + 1;
+    float* tw = (float*)malloc(sizeof(float)*2*count);
+
+    if (!tw) return NULL;
+
+    for (long k = 0; k < count; k++) {
+        double angle = 2.0*FFT_PI*(double)k/(double)n;
+        tw[k] = (float)cos(angle);
+        tw[count + k] = (float)sin(angle);
+    }
+
+    return tw;
+}
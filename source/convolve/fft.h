@@ -0,0 +1,118 @@
+/**
+    @file fft - portable real-input FFT for convolve
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    replaces the Accelerate calls the external used to depend on (`vDSP_fft_zrip` & co.) so the
+    same engine can run outside of Max on macOS. the packing is identical to vDSP's: a real signal
+    of length n is stored as n/2 complex values (even samples in `realp`, odd samples in `imagp`),
+    the forward transform is scaled by 2, and the nyquist bin lives in `imagp[0]`.
+
+    nothing in here depends on the Max SDK.
+*/
+
+#ifndef CONVOLVE_FFT_H
+#define CONVOLVE_FFT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* split-complex vector, the same layout as vDSP's `DSPSplitComplex` */
+typedef struct _fft_split {
+    float*  realp;  // real parts (even samples before the forward transform)
+    float*  imagp;  // imaginary parts (odd samples before the forward transform)
+} t_fft_split;
+
+/* precomputed twiddle factors, the equivalent of vDSP's `FFTSetup` */
+typedef struct _fft_setup t_fft_setup;
+
+/* transform direction */
+enum {
+    FFT_FORWARD = 1,
+    FFT_INVERSE = -1
+};
+
+t_fft_setup* fft_setup_new(long log2n);
+void fft_setup_free(t_fft_setup* setup);
+long fft_setup_log2n(const t_fft_setup* setup);
+
+void fft_zrip(const t_fft_setup* setup, t_fft_split* spectrum, long log2n, int direction);
+void fft_zrip_pruned(const t_fft_setup* setup, t_fft_split* spectrum, long log2n, int direction, long length);
+void fft_zrip_product(const t_fft_setup* setup, const t_fft_split* a, const t_fft_split* b, t_fft_split* out, long log2n, long length);
+void fft_zrip_scrambled(const t_fft_setup* setup, t_fft_split* spectrum, long log2n, long length);
+void fft_zrip_product_scrambled(const t_fft_setup* setup, const t_fft_split* a, const t_fft_split* b, t_fft_split* out, long log2n, long length);
+void fft_zrip_inverse_scrambled(const t_fft_setup* setup, t_fft_split* spectrum, long log2n, long length);
+void fft_zvmul(const t_fft_split* a, const t_fft_split* b, t_fft_split* out, long n);
+void fft_zvma(const t_fft_split* a, const t_fft_split* b, const t_fft_split* c, t_fft_split* out, long n);
+void fft_ctoz(const float* samples, t_fft_split* spectrum, long n);
+void fft_ztoc(const t_fft_split* spectrum, float* samples, long n);
+void fft_vsmul(float* samples, float scale, long n);
+
+/* any-length transforms (the equivalent of vDSP's `vDSP_DFT_zrop_CreateSetup`) */
+typedef struct _fft_dft_setup t_fft_dft_setup;
+
+t_fft_dft_setup* fft_dft_setup_new(long n, int direction);
+void fft_dft_setup_free(t_fft_dft_setup* setup);
+long fft_dft_length(const t_fft_dft_setup* setup);
+short fft_dft_execute(const t_fft_dft_setup* setup, t_fft_split* spectrum);
+short fft_dft_execute_pruned(const t_fft_dft_setup* setup, t_fft_split* spectrum, long length);
+short fft_dft_execute_product(const t_fft_dft_setup* setup, const t_fft_split* a, const t_fft_split* b, t_fft_split* out, long length);
+short fft_dft_execute_scrambled(const t_fft_dft_setup* setup, t_fft_split* spectrum, long length);
+short fft_dft_execute_product_scrambled(const t_fft_dft_setup* setup, const t_fft_split* a, const t_fft_split* b, t_fft_split* out, long length);
+short fft_dft_execute_inverse_scrambled(const t_fft_dft_setup* setup, t_fft_split* spectrum, long length);
+
+long fft_good_size(long n);
+long fft_exact_size(long n);
+double fft_cost(long n);
+
+/* many transforms of the same length at once, interleaved so each SIMD lane runs a different one (see fft_batch.c) */
+long fft_batch_stride(long count);
+void fft_batch_interleave(const t_fft_split* spectra, long count, t_fft_split* batch, long stride, long m);
+void fft_batch_deinterleave(const t_fft_split* batch, long stride, t_fft_split* spectra, long count, long m);
+void fft_zrip_batch(const t_fft_setup* setup, t_fft_split* batch, long log2n, int direction, long stride);
+
+/* transforms larger than the cache (see fft_sixstep.c) */
+void fft_set_sixstep_log2n(long log2n);
+long fft_sixstep_log2n(void);
+
+/* per-size choice of power-of-two algorithm, measured by `fft_tune` (see fft_wisdom.c) */
+enum {
+    FFT_STRATEGY_AUTO = 0,      // fixed thresholds
+    FFT_STRATEGY_RADIX4,
+    FFT_STRATEGY_STOCKHAM,
+    FFT_STRATEGY_SIXSTEP
+};
+
+short fft_tune(long min_log2n, long max_log2n);
+int fft_strategy(long log2n);
+void fft_set_strategy(long log2n, int strategy);
+const char* fft_strategy_name(int strategy);
+long fft_wisdom_export(char* text, long size);
+short fft_wisdom_import(const char* text);
+
+/* splitting long transforms between workers (see fft_parallel.c). a runner calls
+   job(data, i, count) for every i < count and returns once they have all finished. */
+#define FFT_MAX_WORKERS 64
+
+typedef void (*t_fft_job)(void* data, long index, long count);
+typedef void (*t_fft_runner)(void* context, t_fft_job job, void* data, long count);
+
+void fft_set_parallel(t_fft_runner runner, void* context, long workers);
+long fft_parallel_workers(void);
+void fft_parallel_run(t_fft_job job, void* data, long count);
+
+/* process-wide, refcounted cache of setups shared by every caller (see fft_cache.c) */
+t_fft_dft_setup* fft_cache_acquire(long n, int direction);
+void fft_cache_release(t_fft_dft_setup* setup);
+void fft_cache_clear(void);
+
+/* SIMD kernel dispatch (see fft_kernels.c) */
+void fft_init(void);
+const char* fft_kernel_name(void);
+short fft_force_kernel(const char* name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONVOLVE_FFT_H */
@@ -0,0 +1,224 @@
+/**
+    @file fft_batch - many real transforms of the same length at once
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    a short transform run on its own keeps few vector lanes busy: its later passes have quarter
+    lengths below the vector width, and the leaves and the real split are scalar. a batch instead
+    stores its transforms interleaved, point j of transform t at j*stride + t, so every pass is the
+    same butterfly on `stride` independent transforms and each vector lane takes one of them.
+
+        fft_batch_interleave    copy `count` packed spectra into a batch (the spare lanes are zeroed)
+        fft_zrip_batch          `fft_zrip` on every transform of the batch
+        fft_batch_deinterleave  copy them back out
+
+    the stride must be a multiple of the vector width to use it fully; `fft_batch_stride` rounds a
+    batch size up to one. any stride works, the passes just fall back to narrower kernels.
+*/
+
+#include "fft.h"
+#include "fft_private.h"
+
+#include <string.h>
+
+static void fft_complex_forward_batch(const t_fft_setup* setup, float* re, float* im, long log2m, long stride);
+static void fft_complex_inverse_batch(const t_fft_setup* setup, float* re, float* im, long log2m, long stride);
+static void fft_radix2_batch(float* re, float* im, long m, long stride);
+static void fft_bitreverse_batch(float* re, float* im, long log2m, long stride);
+static void fft_real_split_batch(float* re, float* im, long m, long stride, const float* tw);
+static void fft_real_merge_batch(float* re, float* im, long m, long stride, const float* tw);
+
+/**
+ @method `fft_batch_stride`
+ - Returns: the stride to store `count` transforms with, rounded up to the width of the active kernels
+*/
+long fft_batch_stride(long count) {
+    long width = fft_kernels->width;
+    return count < 1 ? width : (count + width - 1)/width*width;
+}
+
+/**
+ @method `fft_batch_interleave`
+ copy separate split-complex vectors into one batch
+
+ - Parameters:
+    - spectra: `count` vectors of m complex values each
+    - count: number of vectors (at most `stride`)
+    - batch: m*stride complex values; lanes count .. stride - 1 are set to zero
+    - stride: batch stride
+    - m: complex length of every vector
+*/
+void fft_batch_interleave(const t_fft_split* spectra, long count, t_fft_split* batch, long stride, long m) {
+    for (long j = 0; j < m; j++) {
+        float* re = batch->realp + j*stride;
+        float* im = batch->imagp + j*stride;
+
+        for (long t = 0; t < count; t++) {
+            re[t] = spectra[t].realp[j];
+            im[t] = spectra[t].imagp[j];
+        }
+        for (long t = count; t < stride; t++) re[t] = im[t] = 0.f;
+    }
+}
+
+/**
+ @method `fft_batch_deinterleave`
+ copy the first `count` lanes of a batch out into separate vectors (the inverse of `fft_batch_interleave`)
+*/
+void fft_batch_deinterleave(const t_fft_split* batch, long stride, t_fft_split* spectra, long count, long m) {
+    for (long j = 0; j < m; j++) {
+        const float* re = batch->realp + j*stride;
+        const float* im = batch->imagp + j*stride;
+
+        for (long t = 0; t < count; t++) {
+            spectra[t].realp[j] = re[t];
+            spectra[t].imagp[j] = im[t];
+        }
+    }
+}
+
+/**
+ @method `fft_zrip_batch`
+ `fft_zrip` on every transform of an interleaved batch, with the same packing and scaling
+
+ - Parameters:
+    - setup: twiddle factors from `fft_setup_new` (log2n of the setup must be >= log2n)
+    - batch: n/2 complex values per transform, interleaved with `stride`, transformed in place
+    - log2n: base 2 log of the real transform length n
+    - direction: `FFT_FORWARD` or `FFT_INVERSE`
+    - stride: batch stride (from `fft_batch_stride`)
+*/
+void fft_zrip_batch(const t_fft_setup* setup, t_fft_split* batch, long log2n, int direction, long stride) {
+    long m;
+
+    if (!setup || log2n < 1 || log2n > fft_setup_log2n(setup) || stride < 1) return;
+    m = 1L << (log2n - 1);
+
+    if (direction == FFT_FORWARD) {
+        fft_complex_forward_batch(setup, batch->realp, batch->imagp, log2n - 1, stride);
+        fft_bitreverse_batch(batch->realp, batch->imagp, log2n - 1, stride);
+        fft_real_split_batch(batch->realp, batch->imagp, m, stride, fft_setup_real(setup, log2n));
+    } else {
+        fft_real_merge_batch(batch->realp, batch->imagp, m, stride, fft_setup_real(setup, log2n));
+        fft_bitreverse_batch(batch->realp, batch->imagp, log2n - 1, stride);
+        fft_complex_inverse_batch(setup, batch->realp, batch->imagp, log2n - 1, stride);
+    }
+}
+
+/* radix-4 passes all the way down (a radix-2 one last when log2(m) is odd); with every lane busy,
+   the leaves gain nothing from the codelets */
+static void fft_complex_forward_batch(const t_fft_setup* setup, float* re, float* im, long log2m, long stride) {
+    const t_fft_kernels* k = fft_kernels_for_stride(stride);
+    long m = 1L << log2m;
+    long l2;
+
+    for (l2 = log2m; l2 >= 2; l2 -= 2) k->dif4_batch(re, im, m, 1L << (l2 - 2), stride, fft_setup_radix4(setup, l2));
+    if (l2 == 1) fft_radix2_batch(re, im, m, stride);
+}
+
+static void fft_complex_inverse_batch(const t_fft_setup* setup, float* re, float* im, long log2m, long stride) {
+    const t_fft_kernels* k = fft_kernels_for_stride(stride);
+    long m = 1L << log2m;
+
+    if (log2m & 1) fft_radix2_batch(re, im, m, stride);
+    for (long l2 = (log2m & 1) + 2; l2 <= log2m; l2 += 2) k->dit4_batch(re, im, m, 1L << (l2 - 2), stride, fft_setup_radix4(setup, l2));
+}
+
+static void fft_radix2_batch(float* re, float* im, long m, long stride) {
+    for (long b = 0; b < m; b += 2) {
+        float* r0 = re + b*stride; float* r1 = r0 + stride;
+        float* i0 = im + b*stride; float* i1 = i0 + stride;
+
+        for (long t = 0; t < stride; t++) {
+            float ar = r0[t], ai = i0[t];
+            float br = r1[t], bi = i1[t];
+            r0[t] = ar + br; i0[t] = ai + bi;
+            r1[t] = ar - br; i1[t] = ai - bi;
+        }
+    }
+}
+
+/* `fft_bitreverse` moving whole rows of `stride` values */
+static void fft_bitreverse_batch(float* re, float* im, long log2m, long stride) {
+    unsigned long m = 1UL << log2m;
+    unsigned long j = 0;
+
+    if (log2m < 2) return;
+
+    for (unsigned long i = 1; i < m - 1; i++) {
+        unsigned long bit = m >> 1;
+        while (j & bit) {
+            j ^= bit;
+            bit >>= 1;
+        }
+        j |= bit;
+
+        if (i < j) {
+            float* ri = re + i*stride; float* rj = re + j*stride;
+            float* ii = im + i*stride; float* ij = im + j*stride;
+
+            for (long t = 0; t < stride; t++) {
+                float x = ri[t]; ri[t] = rj[t]; rj[t] = x;
+                x = ii[t]; ii[t] = ij[t]; ij[t] = x;
+            }
+        }
+    }
+}
+
+/* `fft_real_split` on every lane (see there for the maths) */
+static void fft_real_split_batch(float* re, float* im, long m, long stride, const float* tw) {
+    const float* cosine = tw;
+    const float* sine = tw + m/2 + 1;
+
+    for (long t = 0; t < stride; t++) {
+        float z0r = re[t], z0i = im[t];
+        re[t] = 2.f*(z0r + z0i);
+        im[t] = 2.f*(z0r - z0i);
+    }
+
+    for (long k = 1; k <= m/2; k++) {
+        float* rk = re + k*stride; float* rj = re + (m - k)*stride;
+        float* ik = im + k*stride; float* ij = im + (m - k)*stride;
+        float c = cosine[k], s = sine[k];
+
+        /* bin m/2 is its own partner, and the formulas below read both before writing either */
+        for (long t = 0; t < stride; t++) {
+            float er = rk[t] + rj[t], ei = ik[t] - ij[t];
+            float dr = rk[t] - rj[t], di = ik[t] + ij[t];
+
+            float tr = c*di - s*dr;
+            float ti = -c*dr - s*di;
+
+            rk[t] = er + tr; ik[t] = ei + ti;
+            rj[t] = er - tr; ij[t] = ti - ei;
+        }
+    }
+}
+
+/* `fft_real_merge` on every lane */
+static void fft_real_merge_batch(float* re, float* im, long m, long stride, const float* tw) {
+    const float* cosine = tw;
+    const float* sine = tw + m/2 + 1;
+
+    for (long t = 0; t < stride; t++) {
+        float dc = re[t], nyq = im[t];
+        re[t] = dc + nyq;
+        im[t] = dc - nyq;
+    }
+
+    for (long k = 1; k <= m/2; k++) {
+        float* rk = re + k*stride; float* rj = re + (m - k)*stride;
+        float* ik = im + k*stride; float* ij = im + (m - k)*stride;
+        float c = cosine[k], s = sine[k];
+
+        for (long t = 0; t < stride; t++) {
+            float er = rk[t] + rj[t], ei = ik[t] - ij[t];
+            float dr = rk[t] - rj[t], di = ik[t] + ij[t];
+
+            float ur = -s*dr - c*di;
+            float ui = c*dr - s*di;
+
+            rk[t] = er + ur; ik[t] = ei + ui;
+            rj[t] = er - ur; ij[t] = ui - ei;
+        }
+    }
+}
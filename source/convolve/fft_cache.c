@@ -0,0 +1,289 @@
+/**
+    @file fft_cache - process-wide cache of FFT setups
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    building a setup means computing every twiddle factor, which for short convolutions can cost
+    as much as the transforms themselves. setups are therefore cached by (length, direction) and
+    shared by every convolve instance. they're refcounted, and stay cached after their last
+    release (up to FFT_CACHE_MAX_IDLE of them) so the next message of the same size is free.
+
+    power-of-two setups don't own their twiddles: they borrow the smallest cached power-of-two
+    table that is large enough, so one large table serves every smaller power-of-two length.
+
+    the scratch memory of the six-step and mixed-radix transforms is recycled here as well: for
+    long transforms, touching a fresh allocation costs a page fault every 4 KB, which adds up to
+    about as much as the transform itself.
+*/
+
+#include "fft.h"
+#include "fft_private.h"
+
+#include <stdlib.h>
+
+#define FFT_CACHE_MAX_IDLE 16
+
+/* shared power-of-two twiddles */
+typedef struct _fft_cache_table {
+    t_fft_setup*                setup;
+    long                        refcount;   // number of cached setups borrowing it
+    struct _fft_cache_table*    next;
+} t_fft_cache_table;
+
+typedef struct _fft_cache_entry {
+    long                        n;
+    int                         direction;
+    t_fft_dft_setup*            setup;
+    t_fft_cache_table*          table;      // borrowed twiddles (power-of-two lengths only)
+    long                        refcount;   // number of callers currently using it
+    unsigned long               last_used;  // for evicting the least recently used idle entry
+    struct _fft_cache_entry*    next;
+} t_fft_cache_entry;
+
+static t_fft_lock fft_cache_lock = FFT_LOCK_INIT;
+static t_fft_cache_entry* fft_cache_entries = NULL;
+static t_fft_cache_table* fft_cache_tables = NULL;
+static unsigned long fft_cache_clock = 0;
+static float* fft_cache_scratch = NULL;     // idle scratch buffer, and its size in floats
+static long fft_cache_scratch_size = 0;
+
+static t_fft_cache_entry* fft_cache_find(long n, int direction);
+static t_fft_cache_table* fft_cache_table_acquire(long log2n);
+static void fft_cache_table_release(t_fft_cache_table* table);
+static void fft_cache_entry_free(t_fft_cache_entry* entry);
+static void fft_cache_trim(void);
+
+/**
+ @method `fft_cache_acquire`
+ get a setup for a real transform of length n, building it only if it isn't cached yet.
+ every successful call must be balanced by `fft_cache_release`.
+
+ - Parameters:
+    - n: real transform length (as accepted by `fft_dft_setup_new`)
+    - direction: `FFT_FORWARD` or `FFT_INVERSE`
+ - Returns: the shared setup, or NULL if it couldn't be built
+*/
+t_fft_dft_setup* fft_cache_acquire(long n, int direction) {
+    t_fft_cache_entry* entry;
+    t_fft_cache_entry* built;
+    t_fft_dft_setup* setup = NULL;
+
+    fft_lock(&fft_cache_lock);
+    entry = fft_cache_find(n, direction);
+
+    if (!entry) {
+        built = (t_fft_cache_entry*)calloc(1, sizeof(t_fft_cache_entry));
+
+        if (built) {
+            built->n = n;
+            built->direction = direction;
+
+            if (n >= 2 && !(n & (n - 1))) {
+                long log2n = 0;
+                while ((1L << log2n) < n) log2n++;
+                if (n < 8 || fft_strategy(log2n) != FFT_STRATEGY_STOCKHAM) built->table = fft_cache_table_acquire(log2n);
+            }
+        }
+
+        /* the setup is built unlocked: exact-length setups run transforms while they're built,
+           which take scratch from this cache (and building it shouldn't stall other instances) */
+        fft_unlock(&fft_cache_lock);
+        if (built) built->setup = fft_dft_setup_new_with(n, direction, built->table ? built->table->setup : NULL);
+        fft_lock(&fft_cache_lock);
+
+        /* another thread may have cached the same setup in the meantime */
+        entry = fft_cache_find(n, direction);
+
+        if (built && !entry && built->setup) {
+            built->next = fft_cache_entries;
+            fft_cache_entries = entry = built;
+        } else if (built) {
+            fft_cache_entry_free(built);
+        }
+    }
+
+    if (entry) {
+        entry->refcount++;
+        entry->last_used = ++fft_cache_clock;
+        setup = entry->setup;
+    }
+
+    fft_unlock(&fft_cache_lock);
+    return setup;
+}
+
+/**
+ @method `fft_cache_release`
+ give back a setup from `fft_cache_acquire`. it stays cached for later calls, unless too many
+ setups are idle, in which case the least recently used idle ones are freed.
+*/
+void fft_cache_release(t_fft_dft_setup* setup) {
+    if (!setup) return;
+
+    fft_lock(&fft_cache_lock);
+
+    for (t_fft_cache_entry* entry = fft_cache_entries; entry; entry = entry->next) {
+        if (entry->setup == setup) {
+            if (entry->refcount > 0) entry->refcount--;
+            break;
+        }
+    }
+    fft_cache_trim();
+
+    fft_unlock(&fft_cache_lock);
+}
+
+/**
+ @method `fft_cache_clear`
+ free every idle setup (setups still in use are left alone) and the idle scratch buffer. meant
+ to be called when the host is shutting down.
+*/
+void fft_cache_clear(void) {
+    t_fft_cache_entry** link = &fft_cache_entries;
+
+    fft_lock(&fft_cache_lock);
+
+    while (*link) {
+        t_fft_cache_entry* entry = *link;
+
+        if (entry->refcount == 0) {
+            *link = entry->next;
+            fft_cache_entry_free(entry);
+        } else {
+            link = &entry->next;
+        }
+    }
+
+    if (fft_cache_scratch) free((long*)fft_cache_scratch - 2);
+    fft_cache_scratch = NULL;
+    fft_cache_scratch_size = 0;
+
+    fft_unlock(&fft_cache_lock);
+}
+
+/**
+ @method `fft_scratch_acquire`
+ get a buffer of at least `count` floats, reusing the idle one if it's large enough. balance
+ with `fft_scratch_release`.
+
+ - Returns: the buffer, or NULL if it couldn't be allocated
+*/
+float* fft_scratch_acquire(long count) {
+    float* scratch = NULL;
+
+    fft_lock(&fft_cache_lock);
+    if (fft_cache_scratch && fft_cache_scratch_size >= count) {
+        scratch = fft_cache_scratch;
+        fft_cache_scratch = NULL;
+    }
+    fft_unlock(&fft_cache_lock);
+
+    if (!scratch) {
+        /* the size is stored in front of the buffer */
+        long* block = (long*)malloc(sizeof(long)*2 + sizeof(float)*count);
+        if (!block) return NULL;
+        block[0] = count;
+        scratch = (float*)(block + 2);
+    }
+
+    return scratch;
+}
+
+/**
+ @method `fft_scratch_release`
+ give back a buffer from `fft_scratch_acquire`. the largest one released is kept for next time.
+*/
+void fft_scratch_release(float* scratch) {
+    long size;
+
+    if (!scratch) return;
+    size = ((long*)scratch)[-2];
+
+    fft_lock(&fft_cache_lock);
+    if (size > fft_cache_scratch_size || !fft_cache_scratch) {
+        float* old = fft_cache_scratch;
+        fft_cache_scratch = scratch;
+        fft_cache_scratch_size = size;
+        scratch = old;
+    }
+    fft_unlock(&fft_cache_lock);
+
+    if (scratch) free((long*)scratch - 2);
+}
+
+/* cached setup for (n, direction), or NULL (cache lock held) */
+static t_fft_cache_entry* fft_cache_find(long n, int direction) {
+    for (t_fft_cache_entry* entry = fft_cache_entries; entry; entry = entry->next) {
+        if (entry->n == n && entry->direction == direction) return entry;
+    }
+
+    return NULL;
+}
+
+/* smallest cached twiddle table covering 2^log2n, or a new one (cache lock held) */
+static t_fft_cache_table* fft_cache_table_acquire(long log2n) {
+    t_fft_cache_table* best = NULL;
+
+    for (t_fft_cache_table* table = fft_cache_tables; table; table = table->next) {
+        long size = fft_setup_log2n(table->setup);
+        if (size >= log2n && (!best || size < fft_setup_log2n(best->setup))) best = table;
+    }
+
+    if (!best) {
+        best = (t_fft_cache_table*)calloc(1, sizeof(t_fft_cache_table));
+        if (!best) return NULL;
+
+        best->setup = fft_setup_new(log2n);
+        if (!best->setup) {
+            free(best);
+            return NULL;
+        }
+
+        best->next = fft_cache_tables;
+        fft_cache_tables = best;
+    }
+
+    best->refcount++;
+    return best;
+}
+
+/* drop one reference to a twiddle table, freeing it once no setup borrows it (cache lock held) */
+static void fft_cache_table_release(t_fft_cache_table* table) {
+    if (!table || --table->refcount > 0) return;
+
+    for (t_fft_cache_table** link = &fft_cache_tables; *link; link = &(*link)->next) {
+        if (*link == table) {
+            *link = table->next;
+            break;
+        }
+    }
+
+    fft_setup_free(table->setup);
+    free(table);
+}
+
+/* (cache lock held, entry already unlinked) */
+static void fft_cache_entry_free(t_fft_cache_entry* entry) {
+    fft_dft_setup_free(entry->setup);
+    fft_cache_table_release(entry->table);
+    free(entry);
+}
+
+/* evict least recently used idle entries until at most FFT_CACHE_MAX_IDLE are left (cache lock held) */
+static void fft_cache_trim(void) {
+    while (1) {
+        t_fft_cache_entry** oldest = NULL;
+        long idle = 0;
+
+        for (t_fft_cache_entry** link = &fft_cache_entries; *link; link = &(*link)->next) {
+            if ((*link)->refcount) continue;
+            idle++;
+            if (!oldest || (*link)->last_used < (*oldest)->last_used) oldest = link;
+        }
+
+        if (idle <= FFT_CACHE_MAX_IDLE) break;
+
+        t_fft_cache_entry* entry = *oldest;
+        *oldest = entry->next;
+        fft_cache_entry_free(entry);
+    }
+}
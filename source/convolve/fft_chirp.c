@@ -0,0 +1,281 @@
+/**
+    @file fft_chirp - exact-length transforms for lengths the mixed-radix passes can't factor
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    fft_mixed.c covers complex lengths whose prime factors are all FFT_MAX_ODD_RADIX or less. any
+    other length m is computed as a cyclic convolution, using transforms of a length that does
+    factor:
+
+        Rader (m prime, m - 1 factors): numbering the inputs and outputs other than 0 by powers
+        of a primitive root g mod m turns the rest of the DFT into a cyclic convolution of
+        length m - 1, with the sequence w^(g^-q).
+        Bluestein (anything else): since jk = (j^2 + k^2 - (k - j)^2)/2, the DFT is a convolution
+        of x[j]*w^(j^2/2) with the chirp w^(-j^2/2), zero-padded to a length >= 2m - 1.
+
+    the spectrum of the convolution kernel is computed once per setup, so a transform costs one
+    forward and one inverse transform of the convolution length plus O(m) work. the convolution
+    doesn't care about bin order, so the inner transforms skip their bit reversal.
+*/
+
+#include "fft.h"
+#include "fft_private.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct _fft_chirp {
+    long                m;
+    long                length;     // convolution length (complex)
+    short               rader;      // 1 for Rader, 0 for Bluestein
+    t_fft_dft_setup*    forward;    // complex transforms of the convolution length (real length 2*length)
+    t_fft_dft_setup*    inverse;
+    float*              kernel;     // spectrum of the convolution kernel over `length` (split re/im, in bin order)
+    float*              chirp;      // Bluestein: w^(j^2/2) for j < m (split re/im)
+    long*               order;      // Rader: g^r mod m for r < m - 1, then g^-q mod m for q < m - 1
+};
+
+static short fft_chirp_is_prime(long m);
+static long fft_chirp_root(long m);
+static long fft_chirp_powmod(long base, long e, long m);
+static long fft_chirp_length(long m, short* rader);
+static short fft_chirp_convolve(const t_fft_chirp* chirp, t_fft_split* a, const t_fft_split* k);
+
+/**
+ @method `fft_chirp_new`
+ prepare a complex transform of length m with Rader's algorithm (m prime and m - 1 factors) or
+ Bluestein's (anything else)
+
+ - Parameters:
+    - m: complex transform length (at least 2)
+    - direction: `FFT_FORWARD` or `FFT_INVERSE`
+ - Returns: the setup, or NULL if memory ran out
+*/
+t_fft_chirp* fft_chirp_new(long m, int direction) {
+    double sign = direction == FFT_FORWARD ? -1.0 : 1.0;
+    t_fft_chirp* chirp;
+    t_fft_split kernel;
+    long length;
+
+    if (m < 2) return NULL;
+
+    chirp = (t_fft_chirp*)calloc(1, sizeof(t_fft_chirp));
+    if (!chirp) return NULL;
+
+    chirp->m = m;
+    chirp->length = length = fft_chirp_length(m, &chirp->rader);
+    chirp->forward = fft_dft_setup_new(2*length, FFT_FORWARD);
+    chirp->inverse = fft_dft_setup_new(2*length, FFT_INVERSE);
+    chirp->kernel = (float*)calloc(2*length, sizeof(float));
+
+    if (chirp->rader) chirp->order = (long*)malloc(sizeof(long)*2*(m - 1));
+    else chirp->chirp = (float*)malloc(sizeof(float)*2*m);
+
+    if (!chirp->forward || !chirp->inverse || !chirp->kernel || (!chirp->order && !chirp->chirp)) {
+        fft_chirp_free(chirp);
+        return NULL;
+    }
+
+    kernel.realp = chirp->kernel;
+    kernel.imagp = chirp->kernel + length;
+
+    if (chirp->rader) {
+        long g = fft_chirp_root(m);
+        long n = m - 1;
+        long* in = chirp->order;
+        long* out = chirp->order + n;
+
+        in[0] = 1;
+        for (long r = 1; r < n; r++) in[r] = (long)((long long)in[r - 1]*g % m);
+        for (long q = 0; q < n; q++) out[q] = in[(n - q) % n];
+
+        /* b[t] = w^(g^-t), repeated around the end when the convolution is zero-padded */
+        for (long t = 0; t < n; t++) {
+            double angle = sign*2.0*FFT_PI*(double)out[t]/(double)m;
+            kernel.realp[t] = (float)cos(angle);
+            kernel.imagp[t] = (float)sin(angle);
+            if (t && length > n) {
+                kernel.realp[length - n + t] = kernel.realp[t];
+                kernel.imagp[length - n + t] = kernel.imagp[t];
+            }
+        }
+    } else {
+        for (long j = 0; j < m; j++) {
+            /* j^2 mod 2m keeps the angle exact for long transforms */
+            double angle = sign*FFT_PI*(double)((long long)j*j % (2LL*m))/(double)m;
+            float c = (float)cos(angle), s = (float)sin(angle);
+
+            chirp->chirp[j] = c;
+            chirp->chirp[m + j] = s;
+
+            /* the kernel is the conjugate chirp at offsets -(m - 1) .. m - 1 */
+            kernel.realp[j] = c;
+            kernel.imagp[j] = -s;
+            if (j) {
+                kernel.realp[length - j] = c;
+                kernel.imagp[length - j] = -s;
+            }
+        }
+    }
+
+    /* the 1/length of the inverse transform is folded into the kernel */
+    if (fft_dft_complex_scrambled(chirp->forward, kernel.realp, kernel.imagp)) {
+        fft_chirp_free(chirp);
+        return NULL;
+    }
+    fft_vsmul(kernel.realp, 1.f/(float)length, length);
+    fft_vsmul(kernel.imagp, 1.f/(float)length, length);
+
+    return chirp;
+}
+
+void fft_chirp_free(t_fft_chirp* chirp) {
+    if (!chirp) return;
+
+    fft_dft_setup_free(chirp->forward);
+    fft_dft_setup_free(chirp->inverse);
+    free(chirp->kernel);
+    free(chirp->chirp);
+    free(chirp->order);
+    free(chirp);
+}
+
+/**
+ @method `fft_chirp_complex`
+ complex transform of length m on split data, natural order in and out (unscaled)
+
+ - Returns: 0 on success, 1 if scratch memory ran out (nothing is changed)
+*/
+short fft_chirp_complex(const t_fft_chirp* chirp, float* re, float* im) {
+    long m = chirp->m;
+    long length = chirp->length;
+    float* work = fft_scratch_acquire(2*length);
+    t_fft_split a, k;
+
+    if (!work) return 1;
+    a.realp = work;
+    a.imagp = work + length;
+    k.realp = chirp->kernel;
+    k.imagp = chirp->kernel + length;
+
+    if (chirp->rader) {
+        long n = m - 1;
+        const long* in = chirp->order;
+        const long* out = chirp->order + n;
+        float x0r = re[0], x0i = im[0];
+        float sr = x0r, si = x0i;
+
+        for (long r = 0; r < n; r++) {
+            a.realp[r] = re[in[r]];
+            a.imagp[r] = im[in[r]];
+            sr += a.realp[r];
+            si += a.imagp[r];
+        }
+        memset(a.realp + n, 0, sizeof(float)*(length - n));
+        memset(a.imagp + n, 0, sizeof(float)*(length - n));
+
+        if (fft_chirp_convolve(chirp, &a, &k)) {
+            fft_scratch_release(work);
+            return 1;
+        }
+
+        re[0] = sr;
+        im[0] = si;
+        for (long q = 0; q < n; q++) {
+            re[out[q]] = x0r + a.realp[q];
+            im[out[q]] = x0i + a.imagp[q];
+        }
+    } else {
+        const float* wr = chirp->chirp;
+        const float* wi = chirp->chirp + m;
+
+        for (long j = 0; j < m; j++) {
+            a.realp[j] = re[j]*wr[j] - im[j]*wi[j];
+            a.imagp[j] = re[j]*wi[j] + im[j]*wr[j];
+        }
+        memset(a.realp + m, 0, sizeof(float)*(length - m));
+        memset(a.imagp + m, 0, sizeof(float)*(length - m));
+
+        if (fft_chirp_convolve(chirp, &a, &k)) {
+            fft_scratch_release(work);
+            return 1;
+        }
+
+        for (long j = 0; j < m; j++) {
+            re[j] = a.realp[j]*wr[j] - a.imagp[j]*wi[j];
+            im[j] = a.realp[j]*wi[j] + a.imagp[j]*wr[j];
+        }
+    }
+
+    fft_scratch_release(work);
+    return 0;
+}
+
+/**
+ @method `fft_chirp_cost`
+ estimated cost of `fft_chirp_complex` for length m, on the same scale as `fft_mixed_cost`
+*/
+double fft_chirp_cost(long m) {
+    short rader;
+    long length = fft_chirp_length(m, &rader);
+
+    /* two transforms, the kernel multiply, and the pre/post passes over m points */
+    return 2.0*fft_mixed_cost(length) + 6.0*(double)length + 8.0*(double)m;
+}
+
+/* a, cyclically convolved with the kernel over the convolution length (1 if scratch ran out) */
+static short fft_chirp_convolve(const t_fft_chirp* chirp, t_fft_split* a, const t_fft_split* k) {
+    if (fft_dft_complex_scrambled(chirp->forward, a->realp, a->imagp)) return 1;
+    fft_zvmul(a, k, a, chirp->length);
+    return fft_dft_complex_scrambled(chirp->inverse, a->realp, a->imagp);
+}
+
+/* convolution length for m: m - 1 itself for Rader, else the cheapest length >= 2m - 1 */
+static long fft_chirp_length(long m, short* rader) {
+    *rader = fft_chirp_is_prime(m) && fft_mixed_cost(m - 1) < HUGE_VAL;
+    return *rader ? m - 1 : fft_mixed_size(2*m - 1);
+}
+
+static short fft_chirp_is_prime(long m) {
+    if (m < 2) return 0;
+
+    for (long f = 2; f*f <= m; f++) {
+        if (m % f == 0) return 0;
+    }
+
+    return 1;
+}
+
+/* smallest primitive root mod the prime m: g^((m - 1)/f) != 1 for every prime factor f of m - 1 */
+static long fft_chirp_root(long m) {
+    long factors[64];
+    long count = 0;
+    long rest = m - 1;
+
+    for (long f = 2; f*f <= rest; f++) {
+        if (rest % f) continue;
+        factors[count++] = f;
+        while (rest % f == 0) rest /= f;
+    }
+    if (rest > 1) factors[count++] = rest;
+
+    for (long g = 2; g < m; g++) {
+        long i = 0;
+        while (i < count && fft_chirp_powmod(g, (m - 1)/factors[i], m) != 1) i++;
+        if (i == count) return g;
+    }
+
+    return 1;
+}
+
+static long fft_chirp_powmod(long base, long e, long m) {
+    long long result = 1, b = base % m;
+
+    while (e > 0) {
+        if (e & 1) result = result*b % m;
+        b = b*b % m;
+        e >>= 1;
+    }
+
+    return (long)result;
+}
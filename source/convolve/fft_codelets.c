@@ -0,0 +1,167 @@
+/**
+    @file fft_codelets - hard-coded leaf transforms for the power-of-two engine
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    the last two passes of a radix-4 FFT work on blocks of 8 or 16 points with quarter lengths of
+    1 and 2, which is too short for any SIMD kernel and spends most of its time loading twiddles
+    and running loop control. these codelets do those passes in one go, fully unrolled, with the
+    twiddles written out as constants, so the leaves need no table lookups and one memory pass.
+
+    they compute exactly the same butterflies as fft_dif4/fft_dit4 (and the radix-2 pass), so
+    the output order (bit-reversed for the forward direction) is unchanged.
+*/
+
+#include "fft.h"
+#include "fft_private.h"
+
+#define FFT_SQRT1_2 0.70710678118654752f   // cos(pi/4)
+#define FFT_COS_PI8 0.92387953251128674f   // cos(pi/8)
+#define FFT_SIN_PI8 0.38268343236508977f   // sin(pi/8)
+
+/* w^k = exp(-2*pi*i*k/16) for the k used by the 16-point codelets: k = j, 2j, 3j for j < 4 */
+static const float fft_w16r[3][4] = {
+    { 1.f, FFT_COS_PI8, FFT_SQRT1_2, FFT_SIN_PI8 },
+    { 1.f, FFT_SQRT1_2, 0.f, -FFT_SQRT1_2 },
+    { 1.f, FFT_SIN_PI8, -FFT_SQRT1_2, -FFT_COS_PI8 }
+};
+static const float fft_w16i[3][4] = {
+    { 0.f, -FFT_SIN_PI8, -FFT_SQRT1_2, -FFT_COS_PI8 },
+    { 0.f, -FFT_SQRT1_2, -1.f, -FFT_SQRT1_2 },
+    { 0.f, -FFT_COS_PI8, -FFT_SQRT1_2, FFT_SIN_PI8 }
+};
+
+/* the same for the 8-point codelets: k = j, 2j, 3j for j < 2 */
+static const float fft_w8r[3][2] = { { 1.f, FFT_SQRT1_2 }, { 1.f, 0.f }, { 1.f, -FFT_SQRT1_2 } };
+static const float fft_w8i[3][2] = { { 0.f, -FFT_SQRT1_2 }, { 0.f, -1.f }, { 0.f, -FFT_SQRT1_2 } };
+
+/* radix-4 DIF butterfly on x[0], x[q], x[2q], x[3q] with outputs 1..3 twiddled by (w2, w1, w3) */
+#define FFT_DIF4(r, i, q, w1r, w1i, w2r, w2i, w3r, w3i) do {                               \
+    float t0r = r[0] + r[2*(q)], t0i = i[0] + i[2*(q)];                                     \
+    float t1r = r[0] - r[2*(q)], t1i = i[0] - i[2*(q)];                                     \
+    float t2r = r[q] + r[3*(q)], t2i = i[q] + i[3*(q)];                                     \
+    float t3r = r[q] - r[3*(q)], t3i = i[q] - i[3*(q)];                                     \
+    float ur = t0r - t2r, ui = t0i - t2i;                                                   \
+    r[0] = t0r + t2r; i[0] = t0i + t2i;                                                     \
+    r[q] = ur*(w2r) - ui*(w2i); i[q] = ur*(w2i) + ui*(w2r);                                 \
+    ur = t1r + t3i; ui = t1i - t3r;                                                         \
+    r[2*(q)] = ur*(w1r) - ui*(w1i); i[2*(q)] = ur*(w1i) + ui*(w1r);                         \
+    ur = t1r - t3i; ui = t1i + t3r;                                                         \
+    r[3*(q)] = ur*(w3r) - ui*(w3i); i[3*(q)] = ur*(w3i) + ui*(w3r);                         \
+} while (0)
+
+/* transpose of FFT_DIF4 (conjugated twiddles) */
+#define FFT_DIT4(r, i, q, w1r, w1i, w2r, w2i, w3r, w3i) do {                               \
+    float c1r = r[q]*(w2r) + i[q]*(w2i), c1i = i[q]*(w2r) - r[q]*(w2i);                     \
+    float c2r = r[2*(q)]*(w1r) + i[2*(q)]*(w1i), c2i = i[2*(q)]*(w1r) - r[2*(q)]*(w1i);     \
+    float c3r = r[3*(q)]*(w3r) + i[3*(q)]*(w3i), c3i = i[3*(q)]*(w3r) - r[3*(q)]*(w3i);     \
+    float pr = r[0] + c1r, pi = i[0] + c1i;                                                 \
+    float mr = r[0] - c1r, mi = i[0] - c1i;                                                 \
+    float sr = c2r + c3r, si = c2i + c3i;                                                   \
+    float dr = c2r - c3r, di = c2i - c3i;                                                   \
+    r[0] = pr + sr; i[0] = pi + si;                                                         \
+    r[2*(q)] = pr - sr; i[2*(q)] = pi - si;                                                 \
+    r[q] = mr - di; i[q] = mi + dr;                                                         \
+    r[3*(q)] = mr + di; i[3*(q)] = mi - dr;                                                 \
+} while (0)
+
+/* twiddle-free versions for the last (q = 1) pass */
+#define FFT_DIF4_UNIT(r, i) FFT_DIF4(r, i, 1, 1.f, 0.f, 1.f, 0.f, 1.f, 0.f)
+#define FFT_DIT4_UNIT(r, i) FFT_DIT4(r, i, 1, 1.f, 0.f, 1.f, 0.f, 1.f, 0.f)
+
+#define FFT_BUTTERFLY2(r, i) do {                                                           \
+    float br = r[1], bi = i[1];                                                             \
+    r[1] = r[0] - br; i[1] = i[0] - bi;                                                     \
+    r[0] += br; i[0] += bi;                                                                 \
+} while (0)
+
+/**
+ @method `fft_codelet_dif16`
+ the last two forward passes (block lengths 16 and 4) over every 16-point block of m points
+*/
+void fft_codelet_dif16(float* re, float* im, long m) {
+    for (long b = 0; b < m; b += 16) {
+        float* r = re + b;
+        float* i = im + b;
+
+        for (long j = 0; j < 4; j++) {
+            float* rj = r + j;
+            float* ij = i + j;
+            FFT_DIF4(rj, ij, 4, fft_w16r[0][j], fft_w16i[0][j], fft_w16r[1][j], fft_w16i[1][j], fft_w16r[2][j], fft_w16i[2][j]);
+        }
+
+        for (long j = 0; j < 16; j += 4) {
+            float* rj = r + j;
+            float* ij = i + j;
+            FFT_DIF4_UNIT(rj, ij);
+        }
+    }
+}
+
+/**
+ @method `fft_codelet_dit16`
+ the first two inverse passes (block lengths 4 and 16) over every 16-point block of m points
+*/
+void fft_codelet_dit16(float* re, float* im, long m) {
+    for (long b = 0; b < m; b += 16) {
+        float* r = re + b;
+        float* i = im + b;
+
+        for (long j = 0; j < 16; j += 4) {
+            float* rj = r + j;
+            float* ij = i + j;
+            FFT_DIT4_UNIT(rj, ij);
+        }
+
+        for (long j = 0; j < 4; j++) {
+            float* rj = r + j;
+            float* ij = i + j;
+            FFT_DIT4(rj, ij, 4, fft_w16r[0][j], fft_w16i[0][j], fft_w16r[1][j], fft_w16i[1][j], fft_w16r[2][j], fft_w16i[2][j]);
+        }
+    }
+}
+
+/**
+ @method `fft_codelet_dif8`
+ the last two forward passes (block length 8 radix-4, then radix-2) over every 8-point block
+*/
+void fft_codelet_dif8(float* re, float* im, long m) {
+    for (long b = 0; b < m; b += 8) {
+        float* r = re + b;
+        float* i = im + b;
+
+        for (long j = 0; j < 2; j++) {
+            float* rj = r + j;
+            float* ij = i + j;
+            FFT_DIF4(rj, ij, 2, fft_w8r[0][j], fft_w8i[0][j], fft_w8r[1][j], fft_w8i[1][j], fft_w8r[2][j], fft_w8i[2][j]);
+        }
+
+        for (long j = 0; j < 8; j += 2) {
+            float* rj = r + j;
+            float* ij = i + j;
+            FFT_BUTTERFLY2(rj, ij);
+        }
+    }
+}
+
+/**
+ @method `fft_codelet_dit8`
+ the first two inverse passes (radix-2, then block length 8 radix-4) over every 8-point block
+*/
+void fft_codelet_dit8(float* re, float* im, long m) {
+    for (long b = 0; b < m; b += 8) {
+        float* r = re + b;
+        float* i = im + b;
+
+        for (long j = 0; j < 8; j += 2) {
+            float* rj = r + j;
+            float* ij = i + j;
+            FFT_BUTTERFLY2(rj, ij);
+        }
+
+        for (long j = 0; j < 2; j++) {
+            float* rj = r + j;
+            float* ij = i + j;
+            FFT_DIT4(rj, ij, 2, fft_w8r[0][j], fft_w8i[0][j], fft_w8r[1][j], fft_w8i[1][j], fft_w8r[2][j], fft_w8i[2][j]);
+        }
+    }
+}
@@ -0,0 +1,339 @@
+/**
+    @file fft_kernels - SIMD kernel instances and runtime CPU dispatch
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    the butterflies in fft_radix4.h are compiled once per instruction set: scalar everywhere,
+    SSE2/AVX2/AVX-512 on x86 and NEON on arm64. the x86 instances are built with per-function
+    target attributes, so a baseline build still contains all of them and `fft_init` can pick
+    the widest one the host CPU (and OS) actually supports, using cpuid.
+
+    for testing, a specific kernel set can be forced with `fft_force_kernel` or by setting the
+    environment variable CONVOLVE_FFT_KERNEL (scalar, sse2, avx2, avx512 or neon) before loading.
+*/
+
+#include "fft.h"
+#include "fft_private.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define FFT_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define FFT_TARGET_SSE2
+#define FFT_TARGET_AVX2
+#define FFT_TARGET_AVX512
+#else
+#include <cpuid.h>
+#define FFT_TARGET_SSE2 __attribute__((target("sse2")))
+#define FFT_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define FFT_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define FFT_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* cpu features (bits of fft_cpu_features) */
+enum {
+    FFT_CPU_SSE2    = 1 << 0,
+    FFT_CPU_AVX2    = 1 << 1,
+    FFT_CPU_AVX512  = 1 << 2,
+    FFT_CPU_NEON    = 1 << 3
+};
+
+/* scalar kernels (always available, also the reference the SIMD kernels are benchmarked against) */
+#define FFT_SUFFIX scalar
+#define FFT_TARGET
+#define FFT_WIDTH 1
+#define FFT_VEC float
+#define FFT_LOAD(p) (*(p))
+#define FFT_STORE(p, v) (*(p) = (v))
+#define FFT_SET1(x) (x)
+#define FFT_ADD(a, b) ((a) + (b))
+#define FFT_SUB(a, b) ((a) - (b))
+#define FFT_MUL(a, b) ((a) * (b))
+#define FFT_FMA(a, b, c) ((a)*(b) + (c))
+#include "fft_radix4.h"
+#undef FFT_SUFFIX
+#undef FFT_TARGET
+#undef FFT_WIDTH
+#undef FFT_VEC
+#undef FFT_LOAD
+#undef FFT_STORE
+#undef FFT_SET1
+#undef FFT_ADD
+#undef FFT_SUB
+#undef FFT_MUL
+#undef FFT_FMA
+
+static const t_fft_kernels fft_kernels_scalar = {
+    "scalar", 1, NULL, fft_dif4_scalar, fft_dit4_scalar, fft_dif4_pruned_scalar, fft_dit4_pruned_scalar,
+    fft_dif4_batch_scalar, fft_dit4_batch_scalar, fft_zvmul_scalar, fft_zvma_scalar, fft_fir_scalar
+};
+
+#ifdef FFT_X86
+#define FFT_SUFFIX sse2
+#define FFT_TARGET FFT_TARGET_SSE2
+#define FFT_WIDTH 4
+#define FFT_VEC __m128
+#define FFT_LOAD(p) _mm_loadu_ps(p)
+#define FFT_STORE(p, v) _mm_storeu_ps((p), (v))
+#define FFT_SET1(x) _mm_set1_ps(x)
+#define FFT_ADD(a, b) _mm_add_ps((a), (b))
+#define FFT_SUB(a, b) _mm_sub_ps((a), (b))
+#define FFT_MUL(a, b) _mm_mul_ps((a), (b))
+#define FFT_FMA(a, b, c) _mm_add_ps(_mm_mul_ps((a), (b)), (c))
+#include "fft_radix4.h"
+#undef FFT_SUFFIX
+#undef FFT_TARGET
+#undef FFT_WIDTH
+#undef FFT_VEC
+#undef FFT_LOAD
+#undef FFT_STORE
+#undef FFT_SET1
+#undef FFT_ADD
+#undef FFT_SUB
+#undef FFT_MUL
+#undef FFT_FMA
+
+static const t_fft_kernels fft_kernels_sse2 = {
+    "sse2", 4, &fft_kernels_scalar, fft_dif4_sse2, fft_dit4_sse2, fft_dif4_pruned_sse2, fft_dit4_pruned_sse2,
+    fft_dif4_batch_sse2, fft_dit4_batch_sse2, fft_zvmul_sse2, fft_zvma_sse2, fft_fir_sse2
+};
+
+#define FFT_SUFFIX avx2
+#define FFT_TARGET FFT_TARGET_AVX2
+#define FFT_WIDTH 8
+#define FFT_VEC __m256
+#define FFT_LOAD(p) _mm256_loadu_ps(p)
+#define FFT_STORE(p, v) _mm256_storeu_ps((p), (v))
+#define FFT_SET1(x) _mm256_set1_ps(x)
+#define FFT_ADD(a, b) _mm256_add_ps((a), (b))
+#define FFT_SUB(a, b) _mm256_sub_ps((a), (b))
+#define FFT_MUL(a, b) _mm256_mul_ps((a), (b))
+#define FFT_FMA(a, b, c) _mm256_fmadd_ps((a), (b), (c))
+#include "fft_radix4.h"
+#undef FFT_SUFFIX
+#undef FFT_TARGET
+#undef FFT_WIDTH
+#undef FFT_VEC
+#undef FFT_LOAD
+#undef FFT_STORE
+#undef FFT_SET1
+#undef FFT_ADD
+#undef FFT_SUB
+#undef FFT_MUL
+#undef FFT_FMA
+
+static const t_fft_kernels fft_kernels_avx2 = {
+    "avx2", 8, &fft_kernels_sse2, fft_dif4_avx2, fft_dit4_avx2, fft_dif4_pruned_avx2, fft_dit4_pruned_avx2,
+    fft_dif4_batch_avx2, fft_dit4_batch_avx2, fft_zvmul_avx2, fft_zvma_avx2, fft_fir_avx2
+};
+
+#define FFT_SUFFIX avx512
+#define FFT_TARGET FFT_TARGET_AVX512
+#define FFT_WIDTH 16
+#define FFT_VEC __m512
+#define FFT_LOAD(p) _mm512_loadu_ps(p)
+#define FFT_STORE(p, v) _mm512_storeu_ps((p), (v))
+#define FFT_SET1(x) _mm512_set1_ps(x)
+#define FFT_ADD(a, b) _mm512_add_ps((a), (b))
+#define FFT_SUB(a, b) _mm512_sub_ps((a), (b))
+#define FFT_MUL(a, b) _mm512_mul_ps((a), (b))
+#define FFT_FMA(a, b, c) _mm512_fmadd_ps((a), (b), (c))
+#include "fft_radix4.h"
+#undef FFT_SUFFIX
+#undef FFT_TARGET
+#undef FFT_WIDTH
+#undef FFT_VEC
+#undef FFT_LOAD
+#undef FFT_STORE
+#undef FFT_SET1
+#undef FFT_ADD
+#undef FFT_SUB
+#undef FFT_MUL
+#undef FFT_FMA
+
+static const t_fft_kernels fft_kernels_avx512 = {
+    "avx512", 16, &fft_kernels_avx2, fft_dif4_avx512, fft_dit4_avx512, fft_dif4_pruned_avx512, fft_dit4_pruned_avx512,
+    fft_dif4_batch_avx512, fft_dit4_batch_avx512, fft_zvmul_avx512, fft_zvma_avx512, fft_fir_avx512
+};
+#endif
+
+#ifdef FFT_NEON
+#define FFT_SUFFIX neon
+#define FFT_TARGET
+#define FFT_WIDTH 4
+#define FFT_VEC float32x4_t
+#define FFT_LOAD(p) vld1q_f32(p)
+#define FFT_STORE(p, v) vst1q_f32((p), (v))
+#define FFT_SET1(x) vdupq_n_f32(x)
+#define FFT_ADD(a, b) vaddq_f32((a), (b))
+#define FFT_SUB(a, b) vsubq_f32((a), (b))
+#define FFT_MUL(a, b) vmulq_f32((a), (b))
+#define FFT_FMA(a, b, c) vfmaq_f32((c), (a), (b))
+#include "fft_radix4.h"
+#undef FFT_SUFFIX
+#undef FFT_TARGET
+#undef FFT_WIDTH
+#undef FFT_VEC
+#undef FFT_LOAD
+#undef FFT_STORE
+#undef FFT_SET1
+#undef FFT_ADD
+#undef FFT_SUB
+#undef FFT_MUL
+#undef FFT_FMA
+
+static const t_fft_kernels fft_kernels_neon = {
+    "neon", 4, &fft_kernels_scalar, fft_dif4_neon, fft_dit4_neon, fft_dif4_pruned_neon, fft_dit4_pruned_neon,
+    fft_dif4_batch_neon, fft_dit4_batch_neon, fft_zvmul_neon, fft_zvma_neon, fft_fir_neon
+};
+#endif
+
+/* every kernel set compiled in, widest first, with the cpu features it needs */
+static const struct {
+    const t_fft_kernels*    kernels;
+    int                     features;
+} fft_kernels_all[] = {
+#ifdef FFT_X86
+    { &fft_kernels_avx512,  FFT_CPU_AVX512 },
+    { &fft_kernels_avx2,    FFT_CPU_AVX2 },
+    { &fft_kernels_sse2,    FFT_CPU_SSE2 },
+#endif
+#ifdef FFT_NEON
+    { &fft_kernels_neon,    FFT_CPU_NEON },
+#endif
+    { &fft_kernels_scalar,  0 }
+};
+
+const t_fft_kernels* fft_kernels = &fft_kernels_scalar;
+
+static int fft_cpu_features(void);
+
+/**
+ @method `fft_init`
+ pick the widest kernels the CPU supports (or the ones named by CONVOLVE_FFT_KERNEL).
+ call once at load time; until then every transform runs on the scalar kernels.
+*/
+void fft_init(void) {
+    const char* forced = getenv("CONVOLVE_FFT_KERNEL");
+
+    if (forced && !fft_force_kernel(forced)) return;
+    fft_force_kernel("auto");
+}
+
+const char* fft_kernel_name(void) {
+    return fft_kernels->name;
+}
+
+/**
+ @method `fft_force_kernel`
+ use a specific kernel set instead of the detected one
+
+ - Parameter name: `scalar`, `sse2`, `avx2`, `avx512`, `neon`, or `auto` for the widest supported
+ - Returns: 0 on success, 1 if that kernel set isn't compiled in or the CPU doesn't support it
+*/
+short fft_force_kernel(const char* name) {
+    int features = fft_cpu_features();
+    short automatic = !strcmp(name, "auto");
+    long count = sizeof(fft_kernels_all)/sizeof(fft_kernels_all[0]);
+
+    for (long i = 0; i < count; i++) {
+        if ((fft_kernels_all[i].features & features) != fft_kernels_all[i].features) continue;
+
+        if (automatic || !strcmp(name, fft_kernels_all[i].kernels->name)) {
+            fft_kernels = fft_kernels_all[i].kernels;
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+void fft_kernels_scalar_dif4(float* re, float* im, long m, long q, const float* tw) {
+    fft_dif4_scalar(re, im, m, q, tw);
+}
+
+void fft_kernels_scalar_dit4(float* re, float* im, long m, long q, const float* tw) {
+    fft_dit4_scalar(re, im, m, q, tw);
+}
+
+/* widest active kernels whose vectors fit in a pass with quarter length q */
+const t_fft_kernels* fft_kernels_for(long q) {
+    const t_fft_kernels* k = fft_kernels;
+
+    while (q < k->width) k = k->narrower;
+    return k;
+}
+
+/* widest active kernels whose vectors divide a batch stride */
+const t_fft_kernels* fft_kernels_for_stride(long stride) {
+    const t_fft_kernels* k = fft_kernels;
+
+    while (stride % k->width) k = k->narrower;
+    return k;
+}
+
+/* cpu feature detection */
+
+#ifdef FFT_X86
+static void fft_cpuid(unsigned int leaf, unsigned int subleaf, unsigned int* regs) {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, (int)leaf, (int)subleaf);
+    for (int i = 0; i < 4; i++) regs[i] = (unsigned int)r[i];
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/* which register states the OS saves on context switches (XCR0) */
+static unsigned long long fft_xgetbv(void) {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+#endif
+
+static int fft_cpu_features(void) {
+    int features = 0;
+
+#ifdef FFT_X86
+    unsigned int regs[4];   // eax, ebx, ecx, edx
+    unsigned int max_leaf;
+
+    fft_cpuid(0, 0, regs);
+    max_leaf = regs[0];
+
+    fft_cpuid(1, 0, regs);
+    if (regs[3] & (1u << 26)) features |= FFT_CPU_SSE2;
+
+    /* AVX needs both the cpu (avx, osxsave) and the OS (ymm state in XCR0) */
+    if ((regs[2] & (1u << 27)) && (regs[2] & (1u << 28)) && max_leaf >= 7) {
+        unsigned long long xcr0 = fft_xgetbv();
+        short fma = (regs[2] & (1u << 12)) != 0;
+
+        fft_cpuid(7, 0, regs);
+
+        if ((xcr0 & 0x06) == 0x06 && fma && (regs[1] & (1u << 5))) features |= FFT_CPU_AVX2;
+        if ((xcr0 & 0xe6) == 0xe6 && (regs[1] & (1u << 16))) features |= FFT_CPU_AVX512;
+    }
+#endif
+
+#ifdef FFT_NEON
+    /* NEON is part of the arm64 baseline */
+    features |= FFT_CPU_NEON;
+#endif
+
+    return features;
+}
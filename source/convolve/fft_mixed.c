@@ -0,0 +1,745 @@
+/**
+    @file fft_mixed - any-length real transforms and the transform size chooser
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    power-of-two lengths go straight to `fft_zrip`. other lengths n whose half factors into 2, 3,
+    5, 7, 11 and 13 are computed with a mixed-radix Stockham FFT, which works out of place
+    (ping-ponging between the spectrum and a scratch buffer) so that every pass reads and writes
+    in natural order and no digit reversal is needed at the end. any other even length goes
+    through Rader's or Bluestein's algorithm (see fft_chirp.c).
+
+    the packing and scaling are the same as `fft_zrip`, so the two are interchangeable.
+*/
+
+#include "fft.h"
+#include "fft_private.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FFT_MAX_FACTORS 64
+
+struct _fft_dft_setup {
+    long            n;                          // real transform length
+    int             direction;                  // FFT_FORWARD or FFT_INVERSE
+    t_fft_setup*    pow2;                       // power-of-two lengths (NULL otherwise)
+    short           owns_pow2;                  // 0 if `pow2` is borrowed (see fft_dft_setup_new_with)
+    long            log2n;
+    long            nfactors;                   // radices of the mixed-radix passes, in order
+    long            factors[FFT_MAX_FACTORS];
+    float*          twiddles[FFT_MAX_FACTORS];  // per pass: w^(p*t) for p < len/r, 1 <= t < r (split re/im)
+    float*          real;                       // table for fft_real_split/merge
+    t_fft_chirp*    chirp;                      // lengths that don't factor (NULL otherwise)
+};
+
+static long fft_mixed_factor(long m, long* factors);
+static short fft_mixed_complex(const t_fft_dft_setup* setup, float* re, float* im, long count);
+static void fft_pass2(const float* xr, const float* xi, float* yr, float* yi, long len, long s, const float* tw);
+static void fft_pass3(const float* xr, const float* xi, float* yr, float* yi, long len, long s, const float* tw, float sign);
+static void fft_pass4(const float* xr, const float* xi, float* yr, float* yi, long len, long s, const float* tw, float sign);
+static void fft_pass5(const float* xr, const float* xi, float* yr, float* yi, long len, long s, const float* tw, float sign);
+static void fft_pass_odd(const float* xr, const float* xi, float* yr, float* yi, long len, long s, long r, const float* tw, float sign);
+static void fft_pass_spread(const float* xr, const float* xi, float* yr, float* yi, long len, long s, long r, long count, const float* tw);
+
+/**
+ @method `fft_dft_setup_new`
+ prepare a real transform of length n in one direction
+
+ - Parameters:
+    - n: real transform length (any even length; see `fft_good_size` for the fast ones)
+    - direction: `FFT_FORWARD` or `FFT_INVERSE`
+ - Returns: the setup, or NULL if n isn't supported or memory ran out
+*/
+t_fft_dft_setup* fft_dft_setup_new(long n, int direction) {
+    return fft_dft_setup_new_with(n, direction, NULL);
+}
+
+/**
+ @method `fft_dft_setup_new_with`
+ same as `fft_dft_setup_new`, but power-of-two lengths borrow the twiddles in `pow2` (which must
+ cover at least n and outlive the setup) instead of computing their own. used by the plan cache.
+*/
+t_fft_dft_setup* fft_dft_setup_new_with(long n, int direction, t_fft_setup* pow2) {
+    t_fft_dft_setup* setup;
+    long m = n/2;
+
+    if (n < 2 || (n & 1)) return NULL;
+
+    setup = (t_fft_dft_setup*)calloc(1, sizeof(t_fft_dft_setup));
+    if (!setup) return NULL;
+    setup->n = n;
+    setup->direction = direction;
+
+    while ((1L << setup->log2n) < n) setup->log2n++;
+
+    /* powers of two use the (usually faster) radix-4 engine, unless the wisdom says otherwise */
+    if (!(n & (n - 1)) && (n < 8 || fft_strategy(setup->log2n) != FFT_STRATEGY_STOCKHAM)) {
+
+        if (pow2 && fft_setup_log2n(pow2) >= setup->log2n) {
+            setup->pow2 = pow2;
+            return setup;
+        }
+
+        setup->pow2 = fft_setup_new(setup->log2n);
+        setup->owns_pow2 = 1;
+
+        if (!setup->pow2) {
+            fft_dft_setup_free(setup);
+            return NULL;
+        }
+        return setup;
+    }
+
+    setup->nfactors = fft_mixed_factor(m, setup->factors);
+    setup->real = fft_real_twiddles(n);
+
+    /* lengths with a large prime factor are done as a convolution instead */
+    if (!setup->nfactors) setup->chirp = fft_chirp_new(m, direction);
+
+    if ((!setup->nfactors && !setup->chirp) || !setup->real) {
+        fft_dft_setup_free(setup);
+        return NULL;
+    }
+
+    /* twiddles for every pass, with the sign of the direction baked in */
+    double sign = direction == FFT_FORWARD ? -1.0 : 1.0;
+    long len = m;
+
+    for (long f = 0; f < setup->nfactors; f++) {
+        long r = setup->factors[f];
+        long count = (len/r)*(r - 1);
+        float* tw = (float*)malloc(sizeof(float)*2*count);
+
+        if (!tw) {
+            fft_dft_setup_free(setup);
+            return NULL;
+        }
+
+        for (long p = 0; p < len/r; p++) {
+            for (long t = 1; t < r; t++) {
+                double angle = sign*2.0*FFT_PI*(double)(p*t)/(double)len;
+                tw[p*(r - 1) + t - 1] = (float)cos(angle);
+                tw[count + p*(r - 1) + t - 1] = (float)sin(angle);
+            }
+        }
+
+        setup->twiddles[f] = tw;
+        len /= r;
+    }
+
+    return setup;
+}
+
+void fft_dft_setup_free(t_fft_dft_setup* setup) {
+    if (!setup) return;
+
+    if (setup->owns_pow2) fft_setup_free(setup->pow2);
+    for (long f = 0; f < FFT_MAX_FACTORS; f++) free(setup->twiddles[f]);
+    free(setup->real);
+    fft_chirp_free(setup->chirp);
+    free(setup);
+}
+
+long fft_dft_length(const t_fft_dft_setup* setup) {
+    return setup ? setup->n : 0;
+}
+
+/**
+ @method `fft_dft_execute`
+ in-place real transform in the direction the setup was made for (same packing as `fft_zrip`)
+
+ - Parameters:
+    - setup: from `fft_dft_setup_new`
+    - spectrum: n/2 complex values
+ - Returns: 0 on success, 1 if the scratch memory of a mixed-radix length couldn't be allocated
+   (the spectrum is then undefined). powers of two always succeed. the same goes for every
+   `fft_dft_execute` variant below.
+*/
+short fft_dft_execute(const t_fft_dft_setup* setup, t_fft_split* spectrum) {
+    long m = setup->n/2;
+
+    if (setup->pow2) {
+        fft_zrip(setup->pow2, spectrum, setup->log2n, setup->direction);
+    } else if (setup->direction == FFT_FORWARD) {
+        if (fft_mixed_complex(setup, spectrum->realp, spectrum->imagp, m)) return 1;
+        fft_real_split(spectrum->realp, spectrum->imagp, m, setup->real);
+    } else {
+        fft_real_merge(spectrum->realp, spectrum->imagp, m, setup->real);
+        return fft_mixed_complex(setup, spectrum->realp, spectrum->imagp, m);
+    }
+
+    return 0;
+}
+
+/**
+ @method `fft_dft_execute_pruned`
+ `fft_dft_execute` for zero-padded input or partly needed output (see `fft_zrip_pruned`).
+ mixed-radix lengths only prune the forward transform; their inverse always computes everything.
+
+ - Parameters:
+    - setup: from `fft_dft_setup_new`
+    - spectrum: n/2 complex values
+    - length: forward: number of leading samples that may be nonzero. inverse: number of leading
+      samples needed.
+*/
+short fft_dft_execute_pruned(const t_fft_dft_setup* setup, t_fft_split* spectrum, long length) {
+    long m = setup->n/2;
+    long count = (length + 1)/2;
+
+    if (setup->pow2) {
+        fft_zrip_pruned(setup->pow2, spectrum, setup->log2n, setup->direction, length);
+    } else if (setup->direction == FFT_FORWARD) {
+        if (fft_mixed_complex(setup, spectrum->realp, spectrum->imagp, count < m ? count : m)) return 1;
+        fft_real_split(spectrum->realp, spectrum->imagp, m, setup->real);
+    } else {
+        return fft_dft_execute(setup, spectrum);
+    }
+
+    return 0;
+}
+
+/**
+ @method `fft_dft_execute_product`
+ inverse transform of the product of two packed spectra (see `fft_zrip_product`), with the
+ multiplication folded into the first stage of the inverse
+
+ - Parameters:
+    - setup: an `FFT_INVERSE` setup from `fft_dft_setup_new`
+    - a, b: spectra from forward transforms of the same length
+    - out: n/2 complex values for the packed result (may alias `a` or `b`)
+    - length: number of leading samples needed (see `fft_dft_execute_pruned`)
+*/
+short fft_dft_execute_product(const t_fft_dft_setup* setup, const t_fft_split* a, const t_fft_split* b, t_fft_split* out, long length) {
+    long m = setup->n/2;
+
+    if (setup->pow2) {
+        fft_zrip_product(setup->pow2, a, b, out, setup->log2n, length);
+        return 0;
+    }
+
+    fft_real_merge_product(a->realp, a->imagp, b->realp, b->imagp, out->realp, out->imagp, m, setup->real);
+    return fft_mixed_complex(setup, out->realp, out->imagp, m);
+}
+
+/**
+ @method `fft_dft_execute_scrambled`
+ forward `fft_dft_execute_pruned` with the bins left in an unspecified order, only meant to be
+ multiplied with another such spectrum and passed to `fft_dft_execute_product_scrambled` (see
+ `fft_zrip_scrambled`). mixed-radix lengths are already in natural order without any reordering.
+*/
+short fft_dft_execute_scrambled(const t_fft_dft_setup* setup, t_fft_split* spectrum, long length) {
+    if (setup->pow2) {
+        fft_zrip_scrambled(setup->pow2, spectrum, setup->log2n, length);
+        return 0;
+    }
+
+    return fft_dft_execute_pruned(setup, spectrum, length);
+}
+
+/**
+ @method `fft_dft_execute_product_scrambled`
+ `fft_dft_execute_product` for spectra from `fft_dft_execute_scrambled` (natural order output)
+*/
+short fft_dft_execute_product_scrambled(const t_fft_dft_setup* setup, const t_fft_split* a, const t_fft_split* b, t_fft_split* out, long length) {
+    if (setup->pow2) {
+        fft_zrip_product_scrambled(setup->pow2, a, b, out, setup->log2n, length);
+        return 0;
+    }
+
+    return fft_dft_execute_product(setup, a, b, out, length);
+}
+
+/**
+ @method `fft_dft_execute_inverse_scrambled`
+ inverse `fft_dft_execute_pruned` of a spectrum in `fft_dft_execute_scrambled` order, such as a
+ sum of products of those spectra (natural order output)
+
+ - Parameters:
+    - setup: an `FFT_INVERSE` setup from `fft_dft_setup_new`
+    - spectrum: n/2 complex values
+    - length: number of leading samples needed
+*/
+short fft_dft_execute_inverse_scrambled(const t_fft_dft_setup* setup, t_fft_split* spectrum, long length) {
+    if (setup->pow2) {
+        fft_zrip_inverse_scrambled(setup->pow2, spectrum, setup->log2n, length);
+        return 0;
+    }
+
+    return fft_dft_execute_pruned(setup, spectrum, length);
+}
+
+/**
+ @method `fft_good_size`
+ cheapest real transform length that can hold n samples. the exact length (n, or n + 1 if n is
+ odd) is weighed against the best padded one (see `fft_mixed_size`). besides the transforms, the
+ cost counts the passes over the signal outside of them (packing, multiplying, unpacking), which
+ padding makes longer too; that's what lets an awkward exact length win now and then.
+
+ - Parameter n: minimum length (e.g. length1 + length2 - 1 for a linear convolution)
+*/
+long fft_good_size(long n) {
+    long m_min = n < 2 ? 1 : (n + 1)/2;
+    long m_pad = fft_mixed_size(m_min);
+    double cost_pad = fft_mixed_cost(m_pad) + FFT_COST_STREAM*(double)m_pad;
+    double cost_exact;
+
+    if (m_pad == m_min) return 2*m_pad;
+
+    cost_exact = fft_mixed_cost(m_min);
+    if (cost_exact == HUGE_VAL) cost_exact = fft_chirp_cost(m_min);
+    cost_exact += FFT_COST_STREAM*(double)m_min;
+
+    return cost_exact < cost_pad ? 2*m_min : 2*m_pad;
+}
+
+/**
+ @method `fft_exact_size`
+ the shortest real transform length that can hold n samples: n, or n + 1 if n is odd. it's usually
+ slower than `fft_good_size`'s (an awkward length goes through Rader or Bluestein), and it doesn't
+ save memory either unless hundreds of buffers of that length are held at once: a Rader or
+ Bluestein setup keeps a kernel spectrum and scratch of two to four times the length, while the
+ padding `fft_good_size` adds is a few percent.
+*/
+long fft_exact_size(long n) {
+    return n < 2 ? 2 : (n + 1)/2*2;
+}
+
+/**
+ @method `fft_cost`
+ estimated cost of one real transform of length n (n even), on the scale `fft_good_size` uses:
+ the complex transform of n/2 points (or its Rader/Bluestein equivalent) plus the real split.
+ meant for comparing algorithms that need different transform lengths or counts.
+*/
+double fft_cost(long n) {
+    long m = n < 2 ? 1 : n/2;
+    double cost = fft_mixed_cost(m);
+
+    if (cost == HUGE_VAL) cost = fft_chirp_cost(m);
+    return cost + 2.0*(double)m;
+}
+
+/**
+ @method `fft_mixed_size`
+ cheapest complex length >= m_min the passes can do directly. rather than always rounding up to
+ the next power of two, every 7-smooth length is considered, and the one with the lowest
+ estimated cost wins (a power of two still wins when it's close enough).
+*/
+long fft_mixed_size(long m_min) {
+    long m_pow2 = 1;
+    long best;
+    double best_cost;
+
+    while (m_pow2 < m_min) m_pow2 <<= 1;
+    best = m_pow2;
+    best_cost = fft_mixed_cost(m_pow2);
+
+    /* every 7-smooth m between m_min and the next power of two */
+    for (long f7 = 1; f7 <= m_pow2; f7 *= 7) {
+        for (long f5 = f7; f5 <= m_pow2; f5 *= 5) {
+            for (long f3 = f5; f3 <= m_pow2; f3 *= 3) {
+                long m = f3;
+                double cost;
+
+                while (m < m_min) m <<= 1;
+                if (m >= m_pow2) continue;
+
+                cost = fft_mixed_cost(m);
+                if (cost < best_cost) {
+                    best = m;
+                    best_cost = cost;
+                }
+            }
+        }
+    }
+
+    return best;
+}
+
+/* split m into radices (4s first, then 2, 3, 5, 7, 11, 13). returns the number of passes, 0 if
+   m has a larger prime factor */
+static long fft_mixed_factor(long m, long* factors) {
+    static const long radices[] = { 4, 2, 3, 5, 7, 11, 13 };
+    long count = 0;
+
+    for (long i = 0; i < 7 && m > 1; i++) {
+        while (m % radices[i] == 0) {
+            factors[count++] = radices[i];
+            m /= radices[i];
+        }
+    }
+
+    return m == 1 ? count : 0;
+}
+
+/**
+ @method `fft_mixed_cost`
+ rough cost of a complex FFT of length m: points * the sum of the cost per point of each pass.
+ the per-radix weights were fitted to timings of both engines on an AVX2 machine (the
+ power-of-two engine gets a discount for its SIMD butterflies, plus a pass for the bit reversal).
+
+ - Returns: the cost, or HUGE_VAL if m doesn't factor (see fft_chirp.c for those)
+*/
+double fft_mixed_cost(long m) {
+    long factors[FFT_MAX_FACTORS];
+    long count;
+    double per_point = 0.;
+
+    if (!(m & (m - 1))) {
+        long log2m = 0;
+        while ((1L << log2m) < m) log2m++;
+        return (double)m*(0.6*(8.5*(double)(log2m/2) + 5.0*(double)(log2m & 1)) + 2.0);
+    }
+
+    count = fft_mixed_factor(m, factors);
+    if (!count) return HUGE_VAL;
+
+    for (long f = 0; f < count; f++) {
+        switch (factors[f]) {
+            case 2: per_point += 5.0; break;
+            case 3: per_point += 6.5; break;
+            case 4: per_point += 7.5; break;
+            case 5: per_point += 8.0; break;
+            case 7: per_point += 12.0; break;
+            default: per_point += 1.5*(double)factors[f]; break;
+        }
+    }
+
+    /* the stockham passes work out of place, plus possibly one copy back */
+    return (double)m*(per_point + 1.0);
+}
+
+/**
+ @method `fft_dft_complex_scrambled`
+ complex transform of length n/2 in the setup's direction, for convolutions: the forward output
+ and the inverse input are in whatever bin order the engine produces (bit-reversed for powers of
+ two, natural otherwise), so nothing is spent on reordering. unscaled.
+
+ - Returns: 0 on success, 1 if scratch memory ran out (see `fft_dft_execute`)
+*/
+short fft_dft_complex_scrambled(const t_fft_dft_setup* setup, float* re, float* im) {
+    if (!setup->pow2) {
+        return fft_mixed_complex(setup, re, im, setup->n/2);
+    } else if (setup->direction == FFT_FORWARD) {
+        fft_complex_forward(setup->pow2, re, im, setup->log2n - 1);
+    } else {
+        fft_complex_inverse(setup->pow2, re, im, setup->log2n - 1);
+    }
+
+    return 0;
+}
+
+/* complex mixed-radix FFT of length n/2 on split data, natural order in and out. only the first
+   `count` inputs may be nonzero; while they fit in one radix-r slice a pass just spreads them out.
+   returns 1, with nothing changed, if the scratch buffer couldn't be allocated. */
+static short fft_mixed_complex(const t_fft_dft_setup* setup, float* re, float* im, long count) {
+    long m = setup->n/2;
+    float sign = setup->direction == FFT_FORWARD ? -1.f : 1.f;
+    float* work;
+    float *xr = re, *xi = im, *yr, *yi;
+    long len = m, s = 1;
+
+    if (setup->chirp) return fft_chirp_complex(setup->chirp, re, im);
+
+    work = fft_scratch_acquire(2*m);
+    if (!work) return 1;
+    yr = work;
+    yi = work + m;
+
+    for (long f = 0; f < setup->nfactors; f++) {
+        long r = setup->factors[f];
+        float* t;
+
+        if (count <= m/r) {
+            fft_pass_spread(xr, xi, yr, yi, len, s, r, count, setup->twiddles[f]);
+            count = r*s*((count + s - 1)/s);
+        } else {
+            switch (r) {
+                case 2: fft_pass2(xr, xi, yr, yi, len, s, setup->twiddles[f]); break;
+                case 3: fft_pass3(xr, xi, yr, yi, len, s, setup->twiddles[f], sign); break;
+                case 4: fft_pass4(xr, xi, yr, yi, len, s, setup->twiddles[f], sign); break;
+                case 5: fft_pass5(xr, xi, yr, yi, len, s, setup->twiddles[f], sign); break;
+                default: fft_pass_odd(xr, xi, yr, yi, len, s, r, setup->twiddles[f], sign); break;
+            }
+            count = m;
+        }
+
+        len /= r;
+        s *= r;
+        t = xr; xr = yr; yr = t;
+        t = xi; xi = yi; yi = t;
+    }
+
+    /* an odd number of passes leaves the result in the scratch buffer */
+    if (xr != re) {
+        memcpy(re, xr, sizeof(float)*m);
+        memcpy(im, xi, sizeof(float)*m);
+    }
+
+    fft_scratch_release(work);
+    return 0;
+}
+
+/**
+ @method `fft_pass2`
+ one radix-2 stockham pass: for every p < len/2 and q < s,
+    y[q + s*(2p + t)] = (sum_k x[q + s*(p + k*len/2)] * w_2^(t*k)) * w_len^(p*t)
+ the radix-4 and odd passes below follow the same indexing.
+
+ - Parameters:
+    - xr, xi: input
+    - yr, yi: output (must not alias the input)
+    - len: length of the sub-transforms this pass works on
+    - s: stride (product of the radices of the earlier passes)
+    - tw: this pass's twiddles
+*/
+static void fft_pass2(const float* xr, const float* xi, float* yr, float* yi, long len, long s, const float* tw) {
+    long m = len/2;
+    const float* twr = tw;
+    const float* twi = tw + m;
+
+    for (long p = 0; p < m; p++) {
+        float wr = twr[p], wi = twi[p];
+        const float *a0r = xr + s*p, *a0i = xi + s*p;
+        const float *a1r = a0r + s*m, *a1i = a0i + s*m;
+        float *b0r = yr + s*2*p, *b0i = yi + s*2*p;
+        float *b1r = b0r + s, *b1i = b0i + s;
+
+        for (long q = 0; q < s; q++) {
+            float dr = a0r[q] - a1r[q], di = a0i[q] - a1i[q];
+            b0r[q] = a0r[q] + a1r[q];
+            b0i[q] = a0i[q] + a1i[q];
+            b1r[q] = dr*wr - di*wi;
+            b1i[q] = dr*wi + di*wr;
+        }
+    }
+}
+
+static void fft_pass4(const float* xr, const float* xi, float* yr, float* yi, long len, long s, const float* tw, float sign) {
+    long m = len/4;
+    const float* twr = tw;
+    const float* twi = tw + 3*m;
+
+    for (long p = 0; p < m; p++) {
+        float w1r = twr[3*p], w1i = twi[3*p];
+        float w2r = twr[3*p + 1], w2i = twi[3*p + 1];
+        float w3r = twr[3*p + 2], w3i = twi[3*p + 2];
+        const float *a0r = xr + s*p, *a0i = xi + s*p;
+        const float *a1r = a0r + s*m, *a1i = a0i + s*m;
+        const float *a2r = a1r + s*m, *a2i = a1i + s*m;
+        const float *a3r = a2r + s*m, *a3i = a2i + s*m;
+        float *b0r = yr + s*4*p, *b0i = yi + s*4*p;
+        float *b1r = b0r + s, *b1i = b0i + s;
+        float *b2r = b1r + s, *b2i = b1i + s;
+        float *b3r = b2r + s, *b3i = b2i + s;
+
+        for (long q = 0; q < s; q++) {
+            float t0r = a0r[q] + a2r[q], t0i = a0i[q] + a2i[q];
+            float t1r = a0r[q] - a2r[q], t1i = a0i[q] - a2i[q];
+            float t2r = a1r[q] + a3r[q], t2i = a1i[q] + a3i[q];
+            float t3r = a1r[q] - a3r[q], t3i = a1i[q] - a3i[q];
+            float ur, ui;
+
+            b0r[q] = t0r + t2r;
+            b0i[q] = t0i + t2i;
+
+            /* t1 + sign*i*t3 */
+            ur = t1r - sign*t3i; ui = t1i + sign*t3r;
+            b1r[q] = ur*w1r - ui*w1i;
+            b1i[q] = ur*w1i + ui*w1r;
+
+            ur = t0r - t2r; ui = t0i - t2i;
+            b2r[q] = ur*w2r - ui*w2i;
+            b2i[q] = ur*w2i + ui*w2r;
+
+            /* t1 - sign*i*t3 */
+            ur = t1r + sign*t3i; ui = t1i - sign*t3r;
+            b3r[q] = ur*w3r - ui*w3i;
+            b3i[q] = ur*w3i + ui*w3r;
+        }
+    }
+}
+
+static void fft_pass3(const float* xr, const float* xi, float* yr, float* yi, long len, long s, const float* tw, float sign) {
+    long m = len/3;
+    const float* twr = tw;
+    const float* twi = tw + 2*m;
+    const float c = -0.5f;                          // cos(2*pi/3)
+    const float sn = sign*0.86602540378443865f;     // sin(2*pi/3)
+
+    for (long p = 0; p < m; p++) {
+        float w1r = twr[2*p], w1i = twi[2*p];
+        float w2r = twr[2*p + 1], w2i = twi[2*p + 1];
+        const float *a0r = xr + s*p, *a0i = xi + s*p;
+        const float *a1r = a0r + s*m, *a1i = a0i + s*m;
+        const float *a2r = a1r + s*m, *a2i = a1i + s*m;
+        float *b0r = yr + s*3*p, *b0i = yi + s*3*p;
+        float *b1r = b0r + s, *b1i = b0i + s;
+        float *b2r = b1r + s, *b2i = b1i + s;
+
+        for (long q = 0; q < s; q++) {
+            float sr = a1r[q] + a2r[q], si = a1i[q] + a2i[q];
+            float dr = a1r[q] - a2r[q], di = a1i[q] - a2i[q];
+            float pr = a0r[q] + c*sr, pi = a0i[q] + c*si;
+            float qr = -sn*di, qi = sn*dr;
+            float ur, ui;
+
+            b0r[q] = a0r[q] + sr;
+            b0i[q] = a0i[q] + si;
+
+            ur = pr + qr; ui = pi + qi;
+            b1r[q] = ur*w1r - ui*w1i;
+            b1i[q] = ur*w1i + ui*w1r;
+
+            ur = pr - qr; ui = pi - qi;
+            b2r[q] = ur*w2r - ui*w2i;
+            b2i[q] = ur*w2i + ui*w2r;
+        }
+    }
+}
+
+static void fft_pass5(const float* xr, const float* xi, float* yr, float* yi, long len, long s, const float* tw, float sign) {
+    long m = len/5;
+    const float* twr = tw;
+    const float* twi = tw + 4*m;
+    const float c1 = 0.30901699437494742f;          // cos(2*pi/5)
+    const float c2 = -0.80901699437494742f;         // cos(4*pi/5)
+    const float s1 = sign*0.95105651629515357f;     // sin(2*pi/5)
+    const float s2 = sign*0.58778525229247313f;     // sin(4*pi/5)
+
+    for (long p = 0; p < m; p++) {
+        const float* wr = twr + 4*p;
+        const float* wi = twi + 4*p;
+        const float *a0r = xr + s*p, *a0i = xi + s*p;
+        const float *a1r = a0r + s*m, *a1i = a0i + s*m;
+        const float *a2r = a1r + s*m, *a2i = a1i + s*m;
+        const float *a3r = a2r + s*m, *a3i = a2i + s*m;
+        const float *a4r = a3r + s*m, *a4i = a3i + s*m;
+        float *b0r = yr + s*5*p, *b0i = yi + s*5*p;
+
+        for (long q = 0; q < s; q++) {
+            float s1r = a1r[q] + a4r[q], s1i = a1i[q] + a4i[q];
+            float d1r = a1r[q] - a4r[q], d1i = a1i[q] - a4i[q];
+            float s2r = a2r[q] + a3r[q], s2i = a2i[q] + a3i[q];
+            float d2r = a2r[q] - a3r[q], d2i = a2i[q] - a3i[q];
+
+            float p1r = a0r[q] + c1*s1r + c2*s2r, p1i = a0i[q] + c1*s1i + c2*s2i;
+            float p2r = a0r[q] + c2*s1r + c1*s2r, p2i = a0i[q] + c2*s1i + c1*s2i;
+            float q1r = -(s1*d1i + s2*d2i), q1i = s1*d1r + s2*d2r;   // i*(s1*d1 + s2*d2)
+            float q2r = -(s2*d1i - s1*d2i), q2i = s2*d1r - s1*d2r;   // i*(s2*d1 - s1*d2)
+
+            float br[4] = { p1r + q1r, p2r + q2r, p2r - q2r, p1r - q1r };
+            float bi[4] = { p1i + q1i, p2i + q2i, p2i - q2i, p1i - q1i };
+
+            b0r[q] = a0r[q] + s1r + s2r;
+            b0i[q] = a0i[q] + s1i + s2i;
+
+            for (long t = 0; t < 4; t++) {
+                b0r[q + s*(t + 1)] = br[t]*wr[t] - bi[t]*wi[t];
+                b0i[q + s*(t + 1)] = br[t]*wi[t] + bi[t]*wr[t];
+            }
+        }
+    }
+}
+
+/**
+ @method `fft_pass_odd`
+ stockham pass for any odd prime radix r <= FFT_MAX_ODD_RADIX (3 and 5 have their own). outputs t
+ and r - t share the sums of a[k] + a[r-k] and a[k] - a[r-k], so each pair only costs (r - 1)/2
+ multiply-adds per term.
+*/
+static void fft_pass_odd(const float* xr, const float* xi, float* yr, float* yi, long len, long s, long r, const float* tw, float sign) {
+    long m = len/r;
+    long h = (r - 1)/2;
+    long count = m*(r - 1);
+    float c[FFT_MAX_ODD_RADIX], sn[FFT_MAX_ODD_RADIX];
+    float ar[FFT_MAX_ODD_RADIX], ai[FFT_MAX_ODD_RADIX], br[FFT_MAX_ODD_RADIX], bi[FFT_MAX_ODD_RADIX];
+    float sr[FFT_MAX_ODD_RADIX/2 + 1], si[FFT_MAX_ODD_RADIX/2 + 1], dr[FFT_MAX_ODD_RADIX/2 + 1], di[FFT_MAX_ODD_RADIX/2 + 1];
+
+    for (long j = 0; j < r; j++) {
+        c[j] = (float)cos(2.0*FFT_PI*(double)j/(double)r);
+        sn[j] = sign*(float)sin(2.0*FFT_PI*(double)j/(double)r);
+    }
+
+    for (long p = 0; p < m; p++) {
+        const float* twr = tw + p*(r - 1);
+        const float* twi = tw + count + p*(r - 1);
+
+        for (long q = 0; q < s; q++) {
+            for (long k = 0; k < r; k++) {
+                ar[k] = xr[q + s*(p + k*m)];
+                ai[k] = xi[q + s*(p + k*m)];
+            }
+
+            br[0] = ar[0];
+            bi[0] = ai[0];
+            for (long k = 1; k <= h; k++) {
+                sr[k] = ar[k] + ar[r - k]; si[k] = ai[k] + ai[r - k];
+                dr[k] = ar[k] - ar[r - k]; di[k] = ai[k] - ai[r - k];
+                br[0] += sr[k];
+                bi[0] += si[k];
+            }
+
+            for (long t = 1; t <= h; t++) {
+                float pr = ar[0], pi = ai[0];   // a0 + sum s_k*cos
+                float qr = 0.f, qi = 0.f;       // i*sum d_k*sin
+                for (long k = 1; k <= h; k++) {
+                    long j = (t*k) % r;
+                    pr += sr[k]*c[j];
+                    pi += si[k]*c[j];
+                    qr -= di[k]*sn[j];
+                    qi += dr[k]*sn[j];
+                }
+                br[t] = pr + qr; bi[t] = pi + qi;
+                br[r - t] = pr - qr; bi[r - t] = pi - qi;
+            }
+
+            yr[q + s*r*p] = br[0];
+            yi[q + s*r*p] = bi[0];
+            for (long t = 1; t < r; t++) {
+                float wr = twr[t - 1], wi = twi[t - 1];
+                yr[q + s*(r*p + t)] = br[t]*wr - bi[t]*wi;
+                yi[q + s*(r*p + t)] = br[t]*wi + bi[t]*wr;
+            }
+        }
+    }
+}
+
+/**
+ @method `fft_pass_spread`
+ a stockham pass whose input is zero from `count` on, with count <= s*len/r: only the k = 0 term
+ of the sum is left, so y[q + s*(r*p + t)] = x[q + s*p] * w_len^(p*t). the nonzero output is
+ again a prefix, of r*s*ceil(count/s) points; the rest is zeroed.
+*/
+static void fft_pass_spread(const float* xr, const float* xi, float* yr, float* yi, long len, long s, long r, long count, const float* tw) {
+    long m = len/r;
+    long blocks = (count + s - 1)/s;
+    const float* twr = tw;
+    const float* twi = tw + m*(r - 1);
+
+    for (long p = 0; p < blocks; p++) {
+        const float *ar = xr + s*p, *ai = xi + s*p;
+        long valid = count - s*p < s ? count - s*p : s;
+        float *b0r = yr + s*r*p, *b0i = yi + s*r*p;
+
+        memcpy(b0r, ar, sizeof(float)*valid);
+        memcpy(b0i, ai, sizeof(float)*valid);
+        memset(b0r + valid, 0, sizeof(float)*(s - valid));
+        memset(b0i + valid, 0, sizeof(float)*(s - valid));
+
+        for (long t = 1; t < r; t++) {
+            float wr = twr[p*(r - 1) + t - 1], wi = twi[p*(r - 1) + t - 1];
+            float *br = b0r + s*t, *bi = b0i + s*t;
+
+            for (long q = 0; q < valid; q++) {
+                br[q] = ar[q]*wr - ai[q]*wi;
+                bi[q] = ar[q]*wi + ai[q]*wr;
+            }
+            memset(br + valid, 0, sizeof(float)*(s - valid));
+            memset(bi + valid, 0, sizeof(float)*(s - valid));
+        }
+    }
+
+    memset(yr + s*r*blocks, 0, sizeof(float)*(s*len - s*r*blocks));
+    memset(yi + s*r*blocks, 0, sizeof(float)*(s*len - s*r*blocks));
+}
@@ -0,0 +1,87 @@
+/**
+    @file fft_parallel - spreading one transform over several cores
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    the engine doesn't start threads of its own: the host hands it a runner (in the external, one
+    built on sysparallel) that calls a job once per worker and returns when they're all done. the
+    six-step path splits its column and row tiles between the workers this way.
+
+    one caller uses the runner at a time; a transform that starts while another one (or the
+    external's per-channel jobs) is using it just runs on the calling thread.
+*/
+
+#include "fft.h"
+#include "fft_private.h"
+
+#include <stddef.h>
+
+static t_fft_runner fft_parallel_runner = NULL;
+static void* fft_parallel_context = NULL;
+static long fft_parallel_count = 1;
+static t_fft_lock fft_parallel_lock = FFT_LOCK_INIT;
+
+/**
+ @method `fft_set_parallel`
+ let long transforms run on several workers
+
+ - Parameters:
+    - runner: calls a job for every worker index (possibly concurrently), or NULL to go back to
+      running everything on the calling thread
+    - context: passed back to `runner`
+    - workers: number of workers the runner can run at once (at most FFT_MAX_WORKERS)
+*/
+void fft_set_parallel(t_fft_runner runner, void* context, long workers) {
+    fft_lock(&fft_parallel_lock);
+    fft_parallel_runner = runner;
+    fft_parallel_context = context;
+    fft_parallel_count = !runner || workers < 1 ? 1 : workers > FFT_MAX_WORKERS ? FFT_MAX_WORKERS : workers;
+    fft_unlock(&fft_parallel_lock);
+}
+
+long fft_parallel_workers(void) {
+    return fft_parallel_count;
+}
+
+/**
+ @method `fft_parallel_available`
+ whether `fft_parallel_run` would get the runner if it were called now from this thread: not with a
+ single worker, and not while another caller holds it (which includes this thread being one of its
+ jobs). another thread can take it in between, so this is only a hint.
+*/
+short fft_parallel_available(void) {
+    short available;
+
+    if (fft_parallel_count < 2 || !fft_trylock(&fft_parallel_lock)) return 0;
+    available = fft_parallel_runner != NULL;
+    fft_unlock(&fft_parallel_lock);
+    return available;
+}
+
+/* keep the runner busy, so every transform runs on its own thread until `fft_parallel_release` */
+void fft_parallel_hold(void) {
+    fft_lock(&fft_parallel_lock);
+}
+
+void fft_parallel_release(void) {
+    fft_unlock(&fft_parallel_lock);
+}
+
+/**
+ @method `fft_parallel_run`
+ call job(data, i, count) for i = 0 .. count - 1, on the runner if it's free (and there's more than
+ one worker), otherwise one after the other on this thread. returns once every call has finished.
+
+ - Parameter count: number of pieces to split the work into; at most `fft_parallel_workers()`
+*/
+void fft_parallel_run(t_fft_job job, void* data, long count) {
+    if (count > 1 && fft_trylock(&fft_parallel_lock)) {
+        if (fft_parallel_runner && count <= fft_parallel_count) {
+            fft_parallel_runner(fft_parallel_context, job, data, count);
+            fft_unlock(&fft_parallel_lock);
+            return;
+        }
+        fft_unlock(&fft_parallel_lock);
+    }
+
+    for (long i = 0; i < count; i++) job(data, i, count);
+}
@@ -0,0 +1,115 @@
+/**
+    @file fft_private - helpers shared between the fft*.c files (not part of the public API)
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+*/
+
+#ifndef CONVOLVE_FFT_PRIVATE_H
+#define CONVOLVE_FFT_PRIVATE_H
+
+#include "fft.h"
+
+#ifdef _WIN32
+#include <windows.h>
+typedef SRWLOCK t_fft_lock;
+#define FFT_LOCK_INIT SRWLOCK_INIT
+#define fft_lock(l) AcquireSRWLockExclusive(l)
+#define fft_unlock(l) ReleaseSRWLockExclusive(l)
+#define fft_trylock(l) TryAcquireSRWLockExclusive(l)
+typedef volatile LONG t_fft_counter;
+#define fft_counter_next(c) (InterlockedIncrement(c) - 1)
+#else
+#include <pthread.h>
+typedef pthread_mutex_t t_fft_lock;
+#define FFT_LOCK_INIT PTHREAD_MUTEX_INITIALIZER
+#define fft_lock(l) pthread_mutex_lock(l)
+#define fft_unlock(l) pthread_mutex_unlock(l)
+#define fft_trylock(l) (pthread_mutex_trylock(l) == 0)
+typedef long t_fft_counter;
+#define fft_counter_next(c) __atomic_fetch_add(c, 1, __ATOMIC_RELAXED)
+#endif
+
+#define FFT_MAX_LOG2 31
+#define FFT_PI 3.14159265358979323846
+#define FFT_SIXSTEP_LOG2N 22        // default smallest real length (log2) for the six-step path
+#define FFT_SIXSTEP_MIN_LOG2M 8     // shortest complex length (log2) it can do at all
+#define FFT_SCRAMBLED_MIN_LOG2N 4   // real lengths (log2) with a bit-reversed split/merge table
+#define FFT_SCRAMBLED_MAX_LOG2N (FFT_SIXSTEP_LOG2N - 1)
+#define FFT_PARALLEL_LOG2N 17       // smallest real length (log2) worth splitting between workers
+#define FFT_MAX_ODD_RADIX 13        // largest prime the mixed-radix passes handle directly
+#define FFT_COST_STREAM 4.0         // cost per point of the work around a transform (see fft_good_size)
+
+/* set of butterfly passes compiled for one instruction set (see fft_kernels.c) */
+typedef struct _fft_kernels {
+    const char*                 name;
+    long                        width;      // floats per vector; passes with a smaller quarter length use `narrower`
+    const struct _fft_kernels*  narrower;
+    void                        (*dif4)(float* re, float* im, long m, long q, const float* tw);
+    void                        (*dit4)(float* re, float* im, long m, long q, const float* tw);
+    void                        (*dif4_pruned)(float* re, float* im, long m, long q, long count, const float* tw);
+    void                        (*dit4_pruned)(float* re, float* im, long m, long q, long count, const float* tw);
+    void                        (*dif4_batch)(float* re, float* im, long m, long q, long stride, const float* tw);
+    void                        (*dit4_batch)(float* re, float* im, long m, long q, long stride, const float* tw);
+    void                        (*zvmul)(const float* ar, const float* ai, const float* br, const float* bi, float* cr, float* ci, long n);
+    void                        (*zvma)(const float* ar, const float* ai, const float* br, const float* bi, const float* cr, const float* ci, float* dr, float* di, long n);
+    void                        (*fir)(const float* x, const float* h, long taps, float* out, long count);
+} t_fft_kernels;
+
+extern const t_fft_kernels* fft_kernels;    // active kernels (scalar until fft_init runs)
+const t_fft_kernels* fft_kernels_for(long q);
+const t_fft_kernels* fft_kernels_for_stride(long stride);
+
+/* scalar passes, for transforms too short for anything else */
+void fft_kernels_scalar_dif4(float* re, float* im, long m, long q, const float* tw);
+void fft_kernels_scalar_dit4(float* re, float* im, long m, long q, const float* tw);
+
+/* unrolled leaf transforms (see fft_codelets.c) */
+void fft_codelet_dif16(float* re, float* im, long m);
+void fft_codelet_dit16(float* re, float* im, long m);
+void fft_codelet_dif8(float* re, float* im, long m);
+void fft_codelet_dit8(float* re, float* im, long m);
+
+/* the radix-4 engine on one complex block (see fft.c) */
+void fft_complex_forward(const t_fft_setup* setup, float* re, float* im, long log2m);
+void fft_complex_inverse(const t_fft_setup* setup, float* re, float* im, long log2m);
+void fft_complex_forward_pruned(const t_fft_setup* setup, float* re, float* im, long log2m, long count);
+void fft_complex_inverse_pruned(const t_fft_setup* setup, float* re, float* im, long log2m, long count);
+void fft_bitreverse(float* re, float* im, long log2m);
+const float* fft_setup_radix4(const t_fft_setup* setup, long log2m);
+const float* fft_setup_real(const t_fft_setup* setup, long log2n);
+
+/* six-step FFT for transforms larger than the cache (see fft_sixstep.c) */
+float* fft_sixstep_twiddles(long log2m);
+float* fft_scratch_acquire(long count);
+void fft_scratch_release(float* scratch);
+short fft_sixstep_complex(const t_fft_setup* setup, const float* tw, float* re, float* im, long log2m, int direction);
+
+/* whether a transform would get the workers right now, and keeping them from every transform (see fft_parallel.c) */
+short fft_parallel_available(void);
+void fft_parallel_hold(void);
+void fft_parallel_release(void);
+
+/* real <-> half-length complex FFT conversion (see fft.c) */
+void fft_real_split(float* re, float* im, long m, const float* tw);
+void fft_real_merge(float* re, float* im, long m, const float* tw);
+void fft_real_merge_product(const float* ar, const float* ai, const float* br, const float* bi, float* re, float* im, long m, const float* tw);
+float* fft_real_twiddles(long n);
+void fft_real_split_scrambled(float* re, float* im, long m, const float* tw);
+void fft_real_merge_scrambled(float* re, float* im, long m, const float* tw);
+void fft_real_merge_product_scrambled(const float* ar, const float* ai, const float* br, const float* bi, float* re, float* im, long m, const float* tw);
+float* fft_scrambled_twiddles(long log2n);
+
+/* power-of-two setups sharing twiddles with a larger one, and the mixed-radix engine (see fft_mixed.c) */
+t_fft_dft_setup* fft_dft_setup_new_with(long n, int direction, t_fft_setup* pow2);
+short fft_dft_complex_scrambled(const t_fft_dft_setup* setup, float* re, float* im);
+double fft_mixed_cost(long m);
+long fft_mixed_size(long m_min);
+
+/* Rader and Bluestein for lengths that don't factor (see fft_chirp.c) */
+typedef struct _fft_chirp t_fft_chirp;
+
+t_fft_chirp* fft_chirp_new(long m, int direction);
+void fft_chirp_free(t_fft_chirp* chirp);
+short fft_chirp_complex(const t_fft_chirp* chirp, float* re, float* im);
+double fft_chirp_cost(long m);
+
+#endif /* CONVOLVE_FFT_PRIVATE_H */
@@ -0,0 +1,430 @@
+/**
+    @file fft_radix4 - radix-4 butterfly passes, instantiated once per instruction set
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    this header has no include guard on purpose: fft.c includes it once for every instruction set
+    after defining the following macros (a vector "type" of FFT_WIDTH floats and its operations).
+
+        FFT_SUFFIX          suffix appended to every function name (e.g. `sse2`)
+        FFT_TARGET          function attribute needed to use the instruction set (may be empty)
+        FFT_WIDTH           number of floats per vector
+        FFT_VEC             vector type
+        FFT_LOAD(p)         unaligned load of FFT_WIDTH floats
+        FFT_STORE(p, v)     unaligned store of FFT_WIDTH floats
+        FFT_SET1(x)         vector with every lane set to x
+        FFT_ADD(a, b)       a + b
+        FFT_SUB(a, b)       a - b
+        FFT_MUL(a, b)       a * b
+        FFT_FMA(a, b, c)    a * b + c (fused where the instruction set has it)
+
+    all passes work on split-complex data (`re` and `im` arrays) so that every lane of a vector
+    holds the same butterfly leg of a different index j. the vector passes therefore need the
+    quarter length q to be a multiple of FFT_WIDTH; fft.c falls back to the scalar instance otherwise.
+    the batch passes are the exception: there every lane holds a different transform (see fft_batch.c).
+*/
+
+#define FFT_CAT_(a, b) a##_##b
+#define FFT_CAT(a, b) FFT_CAT_(a, b)
+#define FFT_NAME(name) FFT_CAT(name, FFT_SUFFIX)
+
+/**
+ @method `fft_dif4`
+ one decimation-in-frequency radix-4 pass over every block of length 4q (natural order in,
+ bit-reversed order out once all passes have run)
+
+ - Parameters:
+    - re: real parts
+    - im: imaginary parts
+    - m: total number of complex points
+    - q: a quarter of the block length handled by this pass
+    - tw: twiddles w^j, w^2j, w^3j for j < q, stored as six consecutive arrays (re1, im1, re2, im2, re3, im3)
+*/
+static FFT_TARGET void FFT_NAME(fft_dif4)(float* re, float* im, long m, long q, const float* tw) {
+    const float* w1r = tw;
+    const float* w1i = tw + q;
+    const float* w2r = tw + 2*q;
+    const float* w2i = tw + 3*q;
+    const float* w3r = tw + 4*q;
+    const float* w3i = tw + 5*q;
+
+    for (long b = 0; b < m; b += 4*q) {
+        float* r0 = re + b; float* r1 = r0 + q; float* r2 = r1 + q; float* r3 = r2 + q;
+        float* i0 = im + b; float* i1 = i0 + q; float* i2 = i1 + q; float* i3 = i2 + q;
+
+        for (long j = 0; j < q; j += FFT_WIDTH) {
+            FFT_VEC ar0 = FFT_LOAD(r0 + j), ai0 = FFT_LOAD(i0 + j);
+            FFT_VEC ar1 = FFT_LOAD(r1 + j), ai1 = FFT_LOAD(i1 + j);
+            FFT_VEC ar2 = FFT_LOAD(r2 + j), ai2 = FFT_LOAD(i2 + j);
+            FFT_VEC ar3 = FFT_LOAD(r3 + j), ai3 = FFT_LOAD(i3 + j);
+
+            FFT_VEC t0r = FFT_ADD(ar0, ar2), t0i = FFT_ADD(ai0, ai2);
+            FFT_VEC t1r = FFT_SUB(ar0, ar2), t1i = FFT_SUB(ai0, ai2);
+            FFT_VEC t2r = FFT_ADD(ar1, ar3), t2i = FFT_ADD(ai1, ai3);
+            FFT_VEC t3r = FFT_SUB(ar1, ar3), t3i = FFT_SUB(ai1, ai3);
+
+            /* k = 0 (mod 4) needs no twiddle */
+            FFT_STORE(r0 + j, FFT_ADD(t0r, t2r));
+            FFT_STORE(i0 + j, FFT_ADD(t0i, t2i));
+
+            /* k = 2 (mod 4): (t0 - t2) * w^2j */
+            FFT_VEC ur = FFT_SUB(t0r, t2r), ui = FFT_SUB(t0i, t2i);
+            FFT_VEC wr = FFT_LOAD(w2r + j), wi = FFT_LOAD(w2i + j);
+            FFT_STORE(r1 + j, FFT_SUB(FFT_MUL(ur, wr), FFT_MUL(ui, wi)));
+            FFT_STORE(i1 + j, FFT_ADD(FFT_MUL(ur, wi), FFT_MUL(ui, wr)));
+
+            /* k = 1 (mod 4): (t1 - i*t3) * w^j */
+            ur = FFT_ADD(t1r, t3i); ui = FFT_SUB(t1i, t3r);
+            wr = FFT_LOAD(w1r + j); wi = FFT_LOAD(w1i + j);
+            FFT_STORE(r2 + j, FFT_SUB(FFT_MUL(ur, wr), FFT_MUL(ui, wi)));
+            FFT_STORE(i2 + j, FFT_ADD(FFT_MUL(ur, wi), FFT_MUL(ui, wr)));
+
+            /* k = 3 (mod 4): (t1 + i*t3) * w^3j */
+            ur = FFT_SUB(t1r, t3i); ui = FFT_ADD(t1i, t3r);
+            wr = FFT_LOAD(w3r + j); wi = FFT_LOAD(w3i + j);
+            FFT_STORE(r3 + j, FFT_SUB(FFT_MUL(ur, wr), FFT_MUL(ui, wi)));
+            FFT_STORE(i3 + j, FFT_ADD(FFT_MUL(ur, wi), FFT_MUL(ui, wr)));
+        }
+    }
+}
+
+/**
+ @method `fft_dit4`
+ one decimation-in-time radix-4 pass using conjugated twiddles (bit-reversed order in, natural
+ order out once all passes have run). this is the exact transpose of `fft_dif4`, so running
+ both gives back the input scaled by the transform length.
+
+ - Parameters: same as `fft_dif4`
+*/
+static FFT_TARGET void FFT_NAME(fft_dit4)(float* re, float* im, long m, long q, const float* tw) {
+    const float* w1r = tw;
+    const float* w1i = tw + q;
+    const float* w2r = tw + 2*q;
+    const float* w2i = tw + 3*q;
+    const float* w3r = tw + 4*q;
+    const float* w3i = tw + 5*q;
+
+    for (long b = 0; b < m; b += 4*q) {
+        float* r0 = re + b; float* r1 = r0 + q; float* r2 = r1 + q; float* r3 = r2 + q;
+        float* i0 = im + b; float* i1 = i0 + q; float* i2 = i1 + q; float* i3 = i2 + q;
+
+        for (long j = 0; j < q; j += FFT_WIDTH) {
+            FFT_VEC y0r = FFT_LOAD(r0 + j), y0i = FFT_LOAD(i0 + j);
+            FFT_VEC yr, yi, wr, wi;
+
+            /* c1 = y1 * conj(w^2j) */
+            yr = FFT_LOAD(r1 + j); yi = FFT_LOAD(i1 + j);
+            wr = FFT_LOAD(w2r + j); wi = FFT_LOAD(w2i + j);
+            FFT_VEC c1r = FFT_ADD(FFT_MUL(yr, wr), FFT_MUL(yi, wi));
+            FFT_VEC c1i = FFT_SUB(FFT_MUL(yi, wr), FFT_MUL(yr, wi));
+
+            /* c2 = y2 * conj(w^j) */
+            yr = FFT_LOAD(r2 + j); yi = FFT_LOAD(i2 + j);
+            wr = FFT_LOAD(w1r + j); wi = FFT_LOAD(w1i + j);
+            FFT_VEC c2r = FFT_ADD(FFT_MUL(yr, wr), FFT_MUL(yi, wi));
+            FFT_VEC c2i = FFT_SUB(FFT_MUL(yi, wr), FFT_MUL(yr, wi));
+
+            /* c3 = y3 * conj(w^3j) */
+            yr = FFT_LOAD(r3 + j); yi = FFT_LOAD(i3 + j);
+            wr = FFT_LOAD(w3r + j); wi = FFT_LOAD(w3i + j);
+            FFT_VEC c3r = FFT_ADD(FFT_MUL(yr, wr), FFT_MUL(yi, wi));
+            FFT_VEC c3i = FFT_SUB(FFT_MUL(yi, wr), FFT_MUL(yr, wi));
+
+            FFT_VEC pr = FFT_ADD(y0r, c1r), pi = FFT_ADD(y0i, c1i);
+            FFT_VEC mr = FFT_SUB(y0r, c1r), mi = FFT_SUB(y0i, c1i);
+            FFT_VEC sr = FFT_ADD(c2r, c3r), si = FFT_ADD(c2i, c3i);
+            FFT_VEC dr = FFT_SUB(c2r, c3r), di = FFT_SUB(c2i, c3i);
+
+            FFT_STORE(r0 + j, FFT_ADD(pr, sr)); FFT_STORE(i0 + j, FFT_ADD(pi, si));
+            FFT_STORE(r2 + j, FFT_SUB(pr, sr)); FFT_STORE(i2 + j, FFT_SUB(pi, si));
+            FFT_STORE(r1 + j, FFT_SUB(mr, di)); FFT_STORE(i1 + j, FFT_ADD(mi, dr));   // m + i*d
+            FFT_STORE(r3 + j, FFT_ADD(mr, di)); FFT_STORE(i3 + j, FFT_SUB(mi, dr));   // m - i*d
+        }
+    }
+}
+
+/**
+ @method `fft_dif4_pruned`
+ `fft_dif4` for blocks whose inputs are all zero except the first `count` (a multiple of
+ FFT_WIDTH, at most q). every output is then just an input times a twiddle, and outputs past
+ the first `count` of each quarter stay zero, so they aren't touched at all.
+
+ - Parameters: same as `fft_dif4`, plus
+    - count: number of leading inputs per block that may be nonzero
+*/
+static FFT_TARGET void FFT_NAME(fft_dif4_pruned)(float* re, float* im, long m, long q, long count, const float* tw) {
+    const float* w1r = tw;
+    const float* w1i = tw + q;
+    const float* w2r = tw + 2*q;
+    const float* w2i = tw + 3*q;
+    const float* w3r = tw + 4*q;
+    const float* w3i = tw + 5*q;
+
+    for (long b = 0; b < m; b += 4*q) {
+        float* r0 = re + b; float* r1 = r0 + q; float* r2 = r1 + q; float* r3 = r2 + q;
+        float* i0 = im + b; float* i1 = i0 + q; float* i2 = i1 + q; float* i3 = i2 + q;
+
+        for (long j = 0; j < count; j += FFT_WIDTH) {
+            FFT_VEC ar = FFT_LOAD(r0 + j), ai = FFT_LOAD(i0 + j);
+            FFT_VEC wr, wi;
+
+            /* output 0 is the input itself */
+            wr = FFT_LOAD(w2r + j); wi = FFT_LOAD(w2i + j);
+            FFT_STORE(r1 + j, FFT_SUB(FFT_MUL(ar, wr), FFT_MUL(ai, wi)));
+            FFT_STORE(i1 + j, FFT_ADD(FFT_MUL(ar, wi), FFT_MUL(ai, wr)));
+
+            wr = FFT_LOAD(w1r + j); wi = FFT_LOAD(w1i + j);
+            FFT_STORE(r2 + j, FFT_SUB(FFT_MUL(ar, wr), FFT_MUL(ai, wi)));
+            FFT_STORE(i2 + j, FFT_ADD(FFT_MUL(ar, wi), FFT_MUL(ai, wr)));
+
+            wr = FFT_LOAD(w3r + j); wi = FFT_LOAD(w3i + j);
+            FFT_STORE(r3 + j, FFT_SUB(FFT_MUL(ar, wr), FFT_MUL(ai, wi)));
+            FFT_STORE(i3 + j, FFT_ADD(FFT_MUL(ar, wi), FFT_MUL(ai, wr)));
+        }
+    }
+}
+
+/**
+ @method `fft_dit4_pruned`
+ `fft_dit4` computing only the first `count` outputs of every block (a multiple of FFT_WIDTH, at
+ most q), i.e. only the sums y0 + c1 + c2 + c3. the rest of each block is left as it was.
+
+ - Parameters: same as `fft_dif4_pruned`, with count the number of leading outputs needed
+*/
+static FFT_TARGET void FFT_NAME(fft_dit4_pruned)(float* re, float* im, long m, long q, long count, const float* tw) {
+    const float* w1r = tw;
+    const float* w1i = tw + q;
+    const float* w2r = tw + 2*q;
+    const float* w2i = tw + 3*q;
+    const float* w3r = tw + 4*q;
+    const float* w3i = tw + 5*q;
+
+    for (long b = 0; b < m; b += 4*q) {
+        float* r0 = re + b; float* r1 = r0 + q; float* r2 = r1 + q; float* r3 = r2 + q;
+        float* i0 = im + b; float* i1 = i0 + q; float* i2 = i1 + q; float* i3 = i2 + q;
+
+        for (long j = 0; j < count; j += FFT_WIDTH) {
+            FFT_VEC sr = FFT_LOAD(r0 + j), si = FFT_LOAD(i0 + j);
+            FFT_VEC yr, yi, wr, wi;
+
+            /* y0 + y1*conj(w^2j) + y2*conj(w^j) + y3*conj(w^3j) */
+            yr = FFT_LOAD(r1 + j); yi = FFT_LOAD(i1 + j);
+            wr = FFT_LOAD(w2r + j); wi = FFT_LOAD(w2i + j);
+            sr = FFT_ADD(sr, FFT_ADD(FFT_MUL(yr, wr), FFT_MUL(yi, wi)));
+            si = FFT_ADD(si, FFT_SUB(FFT_MUL(yi, wr), FFT_MUL(yr, wi)));
+
+            yr = FFT_LOAD(r2 + j); yi = FFT_LOAD(i2 + j);
+            wr = FFT_LOAD(w1r + j); wi = FFT_LOAD(w1i + j);
+            sr = FFT_ADD(sr, FFT_ADD(FFT_MUL(yr, wr), FFT_MUL(yi, wi)));
+            si = FFT_ADD(si, FFT_SUB(FFT_MUL(yi, wr), FFT_MUL(yr, wi)));
+
+            yr = FFT_LOAD(r3 + j); yi = FFT_LOAD(i3 + j);
+            wr = FFT_LOAD(w3r + j); wi = FFT_LOAD(w3i + j);
+            sr = FFT_ADD(sr, FFT_ADD(FFT_MUL(yr, wr), FFT_MUL(yi, wi)));
+            si = FFT_ADD(si, FFT_SUB(FFT_MUL(yi, wr), FFT_MUL(yr, wi)));
+
+            FFT_STORE(r0 + j, sr);
+            FFT_STORE(i0 + j, si);
+        }
+    }
+}
+
+/**
+ @method `fft_dif4_batch`
+ `fft_dif4` on a batch of transforms stored interleaved: point j of transform t is at
+ j*stride + t, so all the transforms share every twiddle and each lane of a vector works on a
+ different one. stride must be a multiple of FFT_WIDTH.
+
+ - Parameters: same as `fft_dif4`, plus
+    - stride: distance between consecutive points of one transform (at least the batch size)
+*/
+static FFT_TARGET void FFT_NAME(fft_dif4_batch)(float* re, float* im, long m, long q, long stride, const float* tw) {
+    const float* w1r = tw;
+    const float* w1i = tw + q;
+    const float* w2r = tw + 2*q;
+    const float* w2i = tw + 3*q;
+    const float* w3r = tw + 4*q;
+    const float* w3i = tw + 5*q;
+    long quarter = q*stride;
+
+    for (long b = 0; b < m; b += 4*q) {
+        for (long j = 0; j < q; j++) {
+            float* r0 = re + (b + j)*stride; float* r1 = r0 + quarter; float* r2 = r1 + quarter; float* r3 = r2 + quarter;
+            float* i0 = im + (b + j)*stride; float* i1 = i0 + quarter; float* i2 = i1 + quarter; float* i3 = i2 + quarter;
+            FFT_VEC v1r = FFT_SET1(w1r[j]), v1i = FFT_SET1(w1i[j]);
+            FFT_VEC v2r = FFT_SET1(w2r[j]), v2i = FFT_SET1(w2i[j]);
+            FFT_VEC v3r = FFT_SET1(w3r[j]), v3i = FFT_SET1(w3i[j]);
+
+            for (long t = 0; t < stride; t += FFT_WIDTH) {
+                FFT_VEC ar0 = FFT_LOAD(r0 + t), ai0 = FFT_LOAD(i0 + t);
+                FFT_VEC ar1 = FFT_LOAD(r1 + t), ai1 = FFT_LOAD(i1 + t);
+                FFT_VEC ar2 = FFT_LOAD(r2 + t), ai2 = FFT_LOAD(i2 + t);
+                FFT_VEC ar3 = FFT_LOAD(r3 + t), ai3 = FFT_LOAD(i3 + t);
+
+                FFT_VEC t0r = FFT_ADD(ar0, ar2), t0i = FFT_ADD(ai0, ai2);
+                FFT_VEC t1r = FFT_SUB(ar0, ar2), t1i = FFT_SUB(ai0, ai2);
+                FFT_VEC t2r = FFT_ADD(ar1, ar3), t2i = FFT_ADD(ai1, ai3);
+                FFT_VEC t3r = FFT_SUB(ar1, ar3), t3i = FFT_SUB(ai1, ai3);
+                FFT_VEC ur, ui;
+
+                FFT_STORE(r0 + t, FFT_ADD(t0r, t2r));
+                FFT_STORE(i0 + t, FFT_ADD(t0i, t2i));
+
+                ur = FFT_SUB(t0r, t2r); ui = FFT_SUB(t0i, t2i);
+                FFT_STORE(r1 + t, FFT_SUB(FFT_MUL(ur, v2r), FFT_MUL(ui, v2i)));
+                FFT_STORE(i1 + t, FFT_ADD(FFT_MUL(ur, v2i), FFT_MUL(ui, v2r)));
+
+                ur = FFT_ADD(t1r, t3i); ui = FFT_SUB(t1i, t3r);
+                FFT_STORE(r2 + t, FFT_SUB(FFT_MUL(ur, v1r), FFT_MUL(ui, v1i)));
+                FFT_STORE(i2 + t, FFT_ADD(FFT_MUL(ur, v1i), FFT_MUL(ui, v1r)));
+
+                ur = FFT_SUB(t1r, t3i); ui = FFT_ADD(t1i, t3r);
+                FFT_STORE(r3 + t, FFT_SUB(FFT_MUL(ur, v3r), FFT_MUL(ui, v3i)));
+                FFT_STORE(i3 + t, FFT_ADD(FFT_MUL(ur, v3i), FFT_MUL(ui, v3r)));
+            }
+        }
+    }
+}
+
+/**
+ @method `fft_dit4_batch`
+ `fft_dit4` on interleaved transforms (see `fft_dif4_batch`)
+*/
+static FFT_TARGET void FFT_NAME(fft_dit4_batch)(float* re, float* im, long m, long q, long stride, const float* tw) {
+    const float* w1r = tw;
+    const float* w1i = tw + q;
+    const float* w2r = tw + 2*q;
+    const float* w2i = tw + 3*q;
+    const float* w3r = tw + 4*q;
+    const float* w3i = tw + 5*q;
+    long quarter = q*stride;
+
+    for (long b = 0; b < m; b += 4*q) {
+        for (long j = 0; j < q; j++) {
+            float* r0 = re + (b + j)*stride; float* r1 = r0 + quarter; float* r2 = r1 + quarter; float* r3 = r2 + quarter;
+            float* i0 = im + (b + j)*stride; float* i1 = i0 + quarter; float* i2 = i1 + quarter; float* i3 = i2 + quarter;
+            FFT_VEC v1r = FFT_SET1(w1r[j]), v1i = FFT_SET1(w1i[j]);
+            FFT_VEC v2r = FFT_SET1(w2r[j]), v2i = FFT_SET1(w2i[j]);
+            FFT_VEC v3r = FFT_SET1(w3r[j]), v3i = FFT_SET1(w3i[j]);
+
+            for (long t = 0; t < stride; t += FFT_WIDTH) {
+                FFT_VEC y0r = FFT_LOAD(r0 + t), y0i = FFT_LOAD(i0 + t);
+                FFT_VEC yr, yi;
+
+                yr = FFT_LOAD(r1 + t); yi = FFT_LOAD(i1 + t);
+                FFT_VEC c1r = FFT_ADD(FFT_MUL(yr, v2r), FFT_MUL(yi, v2i));
+                FFT_VEC c1i = FFT_SUB(FFT_MUL(yi, v2r), FFT_MUL(yr, v2i));
+
+                yr = FFT_LOAD(r2 + t); yi = FFT_LOAD(i2 + t);
+                FFT_VEC c2r = FFT_ADD(FFT_MUL(yr, v1r), FFT_MUL(yi, v1i));
+                FFT_VEC c2i = FFT_SUB(FFT_MUL(yi, v1r), FFT_MUL(yr, v1i));
+
+                yr = FFT_LOAD(r3 + t); yi = FFT_LOAD(i3 + t);
+                FFT_VEC c3r = FFT_ADD(FFT_MUL(yr, v3r), FFT_MUL(yi, v3i));
+                FFT_VEC c3i = FFT_SUB(FFT_MUL(yi, v3r), FFT_MUL(yr, v3i));
+
+                FFT_VEC pr = FFT_ADD(y0r, c1r), pi = FFT_ADD(y0i, c1i);
+                FFT_VEC mr = FFT_SUB(y0r, c1r), mi = FFT_SUB(y0i, c1i);
+                FFT_VEC sr = FFT_ADD(c2r, c3r), si = FFT_ADD(c2i, c3i);
+                FFT_VEC dr = FFT_SUB(c2r, c3r), di = FFT_SUB(c2i, c3i);
+
+                FFT_STORE(r0 + t, FFT_ADD(pr, sr)); FFT_STORE(i0 + t, FFT_ADD(pi, si));
+                FFT_STORE(r2 + t, FFT_SUB(pr, sr)); FFT_STORE(i2 + t, FFT_SUB(pi, si));
+                FFT_STORE(r1 + t, FFT_SUB(mr, di)); FFT_STORE(i1 + t, FFT_ADD(mi, dr));
+                FFT_STORE(r3 + t, FFT_ADD(mr, di)); FFT_STORE(i3 + t, FFT_SUB(mi, dr));
+            }
+        }
+    }
+}
+
+/**
+ @method `fft_zvmul`
+ pointwise complex multiplication of two split-complex vectors (`vDSP_zvmul` without conjugation).
+ handles any n; the tail that doesn't fill a vector is done one element at a time.
+*/
+static FFT_TARGET void FFT_NAME(fft_zvmul)(const float* ar, const float* ai, const float* br, const float* bi,
+                                           float* cr, float* ci, long n) {
+    long i = 0;
+
+    for (; i + FFT_WIDTH <= n; i += FFT_WIDTH) {
+        FFT_VEC xr = FFT_LOAD(ar + i), xi = FFT_LOAD(ai + i);
+        FFT_VEC yr = FFT_LOAD(br + i), yi = FFT_LOAD(bi + i);
+        FFT_STORE(cr + i, FFT_SUB(FFT_MUL(xr, yr), FFT_MUL(xi, yi)));
+        FFT_STORE(ci + i, FFT_ADD(FFT_MUL(xr, yi), FFT_MUL(xi, yr)));
+    }
+
+    for (; i < n; i++) {
+        float xr = ar[i], xi = ai[i];
+        float yr = br[i], yi = bi[i];
+        cr[i] = xr*yr - xi*yi;
+        ci[i] = xr*yi + xi*yr;
+    }
+}
+
+/**
+ @method `fft_zvma`
+ complex multiply-add of split-complex vectors, d = a*b + c (`vDSP_zvma`). any n, like `fft_zvmul`.
+*/
+static FFT_TARGET void FFT_NAME(fft_zvma)(const float* ar, const float* ai, const float* br, const float* bi,
+                                          const float* cr, const float* ci, float* dr, float* di, long n) {
+    long i = 0;
+
+    for (; i + FFT_WIDTH <= n; i += FFT_WIDTH) {
+        FFT_VEC xr = FFT_LOAD(ar + i), xi = FFT_LOAD(ai + i);
+        FFT_VEC yr = FFT_LOAD(br + i), yi = FFT_LOAD(bi + i);
+        FFT_STORE(dr + i, FFT_ADD(FFT_LOAD(cr + i), FFT_SUB(FFT_MUL(xr, yr), FFT_MUL(xi, yi))));
+        FFT_STORE(di + i, FFT_ADD(FFT_LOAD(ci + i), FFT_ADD(FFT_MUL(xr, yi), FFT_MUL(xi, yr))));
+    }
+
+    for (; i < n; i++) {
+        float xr = ar[i], xi = ai[i];
+        float yr = br[i], yi = bi[i];
+        dr[i] = cr[i] + xr*yr - xi*yi;
+        di[i] = ci[i] + xr*yi + xi*yr;
+    }
+}
+
+/**
+ @method `fft_fir`
+ direct-form FIR over a block of outputs, out[i] = sum over k < taps of h[k]*x[i + k] (see
+ conv_fir.c, which reverses the impulse response and pads the signal so that this is a
+ convolution). the lanes hold consecutive outputs: each tap is broadcast once and multiplied into
+ four vectors of outputs, whose sums stay in registers for the whole impulse response. any count;
+ x needs count + taps - 1 samples.
+*/
+static FFT_TARGET void FFT_NAME(fft_fir)(const float* x, const float* h, long taps, float* out, long count) {
+    long i = 0;
+
+    for (; i + 4*FFT_WIDTH <= count; i += 4*FFT_WIDTH) {
+        const float* p = x + i;
+        FFT_VEC s0 = FFT_SET1(0.f), s1 = FFT_SET1(0.f), s2 = FFT_SET1(0.f), s3 = FFT_SET1(0.f);
+
+        for (long k = 0; k < taps; k++, p++) {
+            FFT_VEC t = FFT_SET1(h[k]);
+            s0 = FFT_FMA(t, FFT_LOAD(p), s0);
+            s1 = FFT_FMA(t, FFT_LOAD(p + FFT_WIDTH), s1);
+            s2 = FFT_FMA(t, FFT_LOAD(p + 2*FFT_WIDTH), s2);
+            s3 = FFT_FMA(t, FFT_LOAD(p + 3*FFT_WIDTH), s3);
+        }
+
+        FFT_STORE(out + i, s0);
+        FFT_STORE(out + i + FFT_WIDTH, s1);
+        FFT_STORE(out + i + 2*FFT_WIDTH, s2);
+        FFT_STORE(out + i + 3*FFT_WIDTH, s3);
+    }
+
+    for (; i + FFT_WIDTH <= count; i += FFT_WIDTH) {
+        FFT_VEC s = FFT_SET1(0.f);
+        for (long k = 0; k < taps; k++) s = FFT_FMA(FFT_SET1(h[k]), FFT_LOAD(x + i + k), s);
+        FFT_STORE(out + i, s);
+    }
+
+    for (; i < count; i++) {
+        float s = 0.f;
+        for (long k = 0; k < taps; k++) s += h[k]*x[i + k];
+        out[i] = s;
+    }
+}
+
+#undef FFT_NAME
+#undef FFT_CAT
+#undef FFT_CAT_
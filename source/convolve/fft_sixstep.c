@@ -0,0 +1,279 @@
+/**
+    @file fft_sixstep - power-of-two transforms too large for the cache
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    the radix-4 engine makes log4(m) passes over the whole array, which is fine while it fits in
+    cache but turns every pass into a trip to main memory for long signals. Bailey's six-step FFT
+    instead views the m = n1*n2 complex values as an n1 x n2 matrix and only ever transforms
+    short, contiguous vectors:
+
+        1. transpose (n1 x n2 -> n2 x n1)
+        2. n2 transforms of length n1 (each fits in cache)
+        3. multiply element (j2, k1) by w^(j2*k1)
+        4. transpose (n2 x n1 -> n1 x n2)
+        5. n1 transforms of length n2
+        6. transpose (n1 x n2 -> n2 x n1), leaving the result in natural order
+
+    done literally that's three transposes and two transform passes through main memory. here
+    the steps are fused into two passes, each working on a tile of FFT_SIXSTEP_BLOCK columns or
+    rows at a time (so every cache line is used whole, and a tile stays in cache throughout):
+
+        columns (1-4): gather a tile of columns, transform them, twiddle, and put them back
+        rows (5-6): transform a tile of rows and transpose it into a scratch matrix
+
+    the sub-transforms skip their bit reversal; the gathers and scatters around them reorder the
+    data anyway, so they just use bit-reversed indices. the six-step path is used for real
+    lengths of 2^`fft_sixstep_log2n()` and up; see bench/fft_sixstep_bench.c for the crossover.
+
+    the tiles of each pass are independent, so when a worker team is set (see fft_parallel.c) they
+    are split between the workers. when a transform would get them (see `fft_parallel_available`),
+    real lengths from 2^FFT_PARALLEL_LOG2N up take this path too.
+*/
+
+#include "fft.h"
+#include "fft_private.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FFT_SIXSTEP_BLOCK 16    // columns/rows per tile (16 floats = one cache line)
+#define FFT_SIXSTEP_PAD 16      // floats between gathered columns, so they don't share cache sets
+
+/* one transform's worth of state, shared by the workers */
+typedef struct _fft_sixstep_job {
+    const t_fft_setup*  setup;
+    const float*        tw;
+    float*              re;
+    float*              im;
+    float*              scratch;    // output matrix (2m), then two tiles per worker
+    const long*         rev;        // bit-reversed indices for n1, then n2
+    long                log2_n1;
+    long                log2_n2;
+    long                tile;       // floats per tile buffer
+} t_fft_sixstep_job;
+
+static long fft_sixstep_min_log2n = FFT_SIXSTEP_LOG2N;
+
+static void fft_sixstep_column_job(void* data, long index, long count);
+static void fft_sixstep_row_job(void* data, long index, long count);
+static void fft_sixstep_copy_job(void* data, long index, long count);
+static void fft_sixstep_bitrev(long* rev, long log2n);
+static void fft_sixstep_columns(const t_fft_setup* setup, const float* tw, float* re, float* im, float* bre, float* bim, const long* rev, long c0, long log2_n1, long log2_n2);
+static void fft_sixstep_rows(const t_fft_setup* setup, float* re, float* im, float* out_re, float* out_im, const long* rev, long r0, long log2_n1, long log2_n2);
+
+/**
+ @method `fft_set_sixstep_log2n`
+ use the six-step algorithm for real transforms of length 2^log2n and up
+
+ - Parameter log2n: smallest length (base 2 log) to use it for, or 0 to restore the default
+*/
+void fft_set_sixstep_log2n(long log2n) {
+    fft_sixstep_min_log2n = log2n > 0 ? log2n : FFT_SIXSTEP_LOG2N;
+}
+
+long fft_sixstep_log2n(void) {
+    return fft_sixstep_min_log2n;
+}
+
+/**
+ @method `fft_sixstep_twiddles`
+ allocate the table for the step 3 twiddles of a complex length m = 2^log2m. rather than storing
+ all m of them, w^e is rebuilt as w^(e & low) * w^(e - (e & low)) from two tables of about
+ sqrt(m) entries each: cos/sin of the low part, then cos/sin of the high part.
+
+ - Returns: the table (free with `free`), or NULL if it couldn't be allocated
+*/
+float* fft_sixstep_twiddles(long log2m) {
+    long h = (log2m + 1)/2;
+    long nlow = 1L << h;
+    long nhigh = 1L << (log2m - h);
+    float* tw = (float*)malloc(sizeof(float)*2*(nlow + nhigh));
+
+    if (!tw) return NULL;
+
+    for (long e = 0; e < nlow; e++) {
+        double angle = -2.0*FFT_PI*(double)e/(double)(1L << log2m);
+        tw[e] = (float)cos(angle);
+        tw[nlow + e] = (float)sin(angle);
+    }
+
+    for (long e = 0; e < nhigh; e++) {
+        double angle = -2.0*FFT_PI*(double)e/(double)nhigh;
+        tw[2*nlow + e] = (float)cos(angle);
+        tw[2*nlow + nhigh + e] = (float)sin(angle);
+    }
+
+    return tw;
+}
+
+/**
+ @method `fft_sixstep_complex`
+ complex FFT of length m = 2^log2m in natural order (unscaled, like the radix-4 engine)
+
+ - Parameters:
+    - setup: radix-4 twiddles covering the row lengths
+    - tw: from `fft_sixstep_twiddles(log2m)`
+    - re, im: the m complex values, transformed in place
+    - log2m: base 2 log of the complex length (at least FFT_SIXSTEP_MIN_LOG2M)
+    - direction: `FFT_FORWARD` or `FFT_INVERSE`
+ - Returns: 0 on success, 1 if the scratch buffer couldn't be allocated (nothing is changed)
+*/
+short fft_sixstep_complex(const t_fft_setup* setup, const float* tw, float* re, float* im, long log2m, int direction) {
+    long log2_n1 = log2m/2;
+    long log2_n2 = log2m - log2_n1;
+    long n1 = 1L << log2_n1;
+    long n2 = 1L << log2_n2;
+    long m = 1L << log2m;
+    long tile = FFT_SIXSTEP_BLOCK*(n1 + FFT_SIXSTEP_PAD);
+    long indices = (long)((sizeof(long)*(n1 + n2) + sizeof(float) - 1)/sizeof(float));
+    long workers = fft_parallel_workers();
+    t_fft_sixstep_job job;
+    long* rev;
+
+    if (log2m < FFT_SIXSTEP_MIN_LOG2M) return 1;
+
+    /* every worker needs at least one tile of rows (there are fewer rows than columns) */
+    if (workers > n1/FFT_SIXSTEP_BLOCK) workers = n1/FFT_SIXSTEP_BLOCK;
+
+    /* the inverse DFT is the forward one with real and imaginary parts swapped on the way in and out */
+    if (direction != FFT_FORWARD) {
+        float* swap = re;
+        re = im;
+        im = swap;
+    }
+
+    job.scratch = fft_scratch_acquire(2*m + 2*tile*workers + indices);
+    if (!job.scratch) return 1;
+
+    rev = (long*)(job.scratch + 2*m + 2*tile*workers);
+    fft_sixstep_bitrev(rev, log2_n1);
+    fft_sixstep_bitrev(rev + n1, log2_n2);
+
+    job.setup = setup;
+    job.tw = tw;
+    job.re = re;
+    job.im = im;
+    job.rev = rev;
+    job.log2_n1 = log2_n1;
+    job.log2_n2 = log2_n2;
+    job.tile = tile;
+
+    /* each pass has to finish on every worker before the next one starts */
+    fft_parallel_run(fft_sixstep_column_job, &job, workers);
+    fft_parallel_run(fft_sixstep_row_job, &job, workers);
+    fft_parallel_run(fft_sixstep_copy_job, &job, workers);
+
+    fft_scratch_release(job.scratch);
+    return 0;
+}
+
+/* worker `index` of `count` takes columns (tiles of them, really) from its share of n2 */
+static void fft_sixstep_column_job(void* data, long index, long count) {
+    t_fft_sixstep_job* job = (t_fft_sixstep_job*)data;
+    long m = 1L << (job->log2_n1 + job->log2_n2);
+    long tiles = (1L << job->log2_n2)/FFT_SIXSTEP_BLOCK;
+    float* bre = job->scratch + 2*m + 2*job->tile*index;
+
+    for (long t = tiles*index/count; t < tiles*(index + 1)/count; t++) {
+        fft_sixstep_columns(job->setup, job->tw, job->re, job->im, bre, bre + job->tile, job->rev, t*FFT_SIXSTEP_BLOCK, job->log2_n1, job->log2_n2);
+    }
+}
+
+static void fft_sixstep_row_job(void* data, long index, long count) {
+    t_fft_sixstep_job* job = (t_fft_sixstep_job*)data;
+    long m = 1L << (job->log2_n1 + job->log2_n2);
+    long n1 = 1L << job->log2_n1;
+    long tiles = n1/FFT_SIXSTEP_BLOCK;
+
+    for (long t = tiles*index/count; t < tiles*(index + 1)/count; t++) {
+        fft_sixstep_rows(job->setup, job->re, job->im, job->scratch, job->scratch + m, job->rev + n1, t*FFT_SIXSTEP_BLOCK, job->log2_n1, job->log2_n2);
+    }
+}
+
+/* the result is in the scratch matrix; copy it back */
+static void fft_sixstep_copy_job(void* data, long index, long count) {
+    t_fft_sixstep_job* job = (t_fft_sixstep_job*)data;
+    long m = 1L << (job->log2_n1 + job->log2_n2);
+    long start = m/count*index;
+    long end = index == count - 1 ? m : m/count*(index + 1);
+
+    memcpy(job->re + start, job->scratch + start, sizeof(float)*(end - start));
+    memcpy(job->im + start, job->scratch + m + start, sizeof(float)*(end - start));
+}
+
+static void fft_sixstep_bitrev(long* rev, long log2n) {
+    long n = 1L << log2n;
+
+    for (long i = 0; i < n; i++) {
+        long r = 0;
+        for (long b = 0; b < log2n; b++) r |= ((i >> b) & 1) << (log2n - 1 - b);
+        rev[i] = r;
+    }
+}
+
+/* steps 1-4 for columns c0 .. c0 + FFT_SIXSTEP_BLOCK of the n1 x n2 matrix, in place. after the
+   transform, column j2 holds X[k1] at position rev[k1]; it goes back to row k1, times w^(j2*k1). */
+static void fft_sixstep_columns(const t_fft_setup* setup, const float* tw, float* re, float* im, float* bre, float* bim, const long* rev, long c0, long log2_n1, long log2_n2) {
+    long n1 = 1L << log2_n1;
+    long n2 = 1L << log2_n2;
+    long stride = n1 + FFT_SIXSTEP_PAD;
+    long log2m = log2_n1 + log2_n2;
+    long mask = (1L << log2m) - 1;
+    long h = (log2m + 1)/2;
+    long nlow = 1L << h;
+    long nhigh = 1L << (log2m - h);
+    const float* lo_c = tw;
+    const float* lo_s = tw + nlow;
+    const float* hi_c = tw + 2*nlow;
+    const float* hi_s = tw + 2*nlow + nhigh;
+
+    for (long r = 0; r < n1; r++) {
+        const float* xr = re + r*n2 + c0;
+        const float* xi = im + r*n2 + c0;
+
+        for (long c = 0; c < FFT_SIXSTEP_BLOCK; c++) {
+            bre[c*stride + r] = xr[c];
+            bim[c*stride + r] = xi[c];
+        }
+    }
+
+    for (long c = 0; c < FFT_SIXSTEP_BLOCK; c++) fft_complex_forward(setup, bre + c*stride, bim + c*stride, log2_n1);
+
+    for (long p = 0; p < n1; p++) {
+        long k1 = rev[p];
+        float* yr = re + k1*n2 + c0;
+        float* yi = im + k1*n2 + c0;
+
+        for (long c = 0; c < FFT_SIXSTEP_BLOCK; c++) {
+            /* w^e = w^(e & low) * w^(e >> h << h), see fft_sixstep_twiddles */
+            long e = ((c0 + c)*k1) & mask;
+            long lo = e & (nlow - 1), hi = e >> h;
+            float wr = lo_c[lo]*hi_c[hi] - lo_s[lo]*hi_s[hi];
+            float wi = lo_c[lo]*hi_s[hi] + lo_s[lo]*hi_c[hi];
+            float xr = bre[c*stride + p], xi = bim[c*stride + p];
+
+            yr[c] = xr*wr - xi*wi;
+            yi[c] = xr*wi + xi*wr;
+        }
+    }
+}
+
+/* steps 5-6 for rows r0 .. r0 + FFT_SIXSTEP_BLOCK: transform them in place, then write X[k2] of
+   row k1 (at position rev[k2]) to element (k2, k1) of the n2 x n1 output */
+static void fft_sixstep_rows(const t_fft_setup* setup, float* re, float* im, float* out_re, float* out_im, const long* rev, long r0, long log2_n1, long log2_n2) {
+    long n1 = 1L << log2_n1;
+    long n2 = 1L << log2_n2;
+
+    for (long r = r0; r < r0 + FFT_SIXSTEP_BLOCK; r++) fft_complex_forward(setup, re + r*n2, im + r*n2, log2_n2);
+
+    for (long q = 0; q < n2; q++) {
+        float* yr = out_re + rev[q]*n1 + r0;
+        float* yi = out_im + rev[q]*n1 + r0;
+
+        for (long r = 0; r < FFT_SIXSTEP_BLOCK; r++) {
+            yr[r] = re[(r0 + r)*n2 + q];
+            yi[r] = im[(r0 + r)*n2 + q];
+        }
+    }
+}
@@ -0,0 +1,210 @@
+/**
+    @file fft_wisdom - per-size choice of power-of-two algorithm, measured on this machine
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    a power-of-two transform can run on three engines:
+
+        radix4      the in-place radix-4 passes with unrolled leaves (fft.c)
+        stockham    the out-of-place mixed-radix passes, with no bit reversal (fft_mixed.c)
+        sixstep     the cache-blocked six-step algorithm (fft_sixstep.c)
+
+    which one wins depends mostly on the cache sizes, so rather than trusting the fixed thresholds
+    `fft_tune` times all of them for every size and remembers the winners. the result ("wisdom")
+    can be exported as text and imported again at startup, so the tuning only runs once per machine.
+    sizes without wisdom fall back to the thresholds.
+
+    wisdom is read when setups are built, so import it before acquiring any (or clear the cache).
+*/
+
+#include "fft.h"
+#include "fft_private.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define FFT_WISDOM_HEADER "convolve fft wisdom 1"
+#define FFT_TUNE_SECONDS 0.02   // minimum timing run per strategy and size
+
+static signed char fft_wisdom[FFT_MAX_LOG2];    // FFT_STRATEGY_* for real lengths 2^i (0: no wisdom)
+
+static const char* const fft_strategy_names[] = { "auto", "radix4", "stockham", "sixstep" };
+
+static double fft_tune_time(long log2n, int strategy, float* data);
+static double fft_tune_now(void);
+
+/**
+ @method `fft_strategy`
+ - Returns: the algorithm the wisdom picked for real length 2^log2n, or `FFT_STRATEGY_AUTO`
+*/
+int fft_strategy(long log2n) {
+    return log2n > 0 && log2n < FFT_MAX_LOG2 ? fft_wisdom[log2n] : FFT_STRATEGY_AUTO;
+}
+
+void fft_set_strategy(long log2n, int strategy) {
+    if (log2n > 0 && log2n < FFT_MAX_LOG2 && strategy >= FFT_STRATEGY_AUTO && strategy <= FFT_STRATEGY_SIXSTEP) {
+        fft_wisdom[log2n] = (signed char)strategy;
+    }
+}
+
+const char* fft_strategy_name(int strategy) {
+    return strategy >= FFT_STRATEGY_AUTO && strategy <= FFT_STRATEGY_SIXSTEP ? fft_strategy_names[strategy] : "?";
+}
+
+/**
+ @method `fft_tune`
+ time every strategy for the real lengths 2^min_log2n .. 2^max_log2n and keep the fastest. takes
+ about a second per size, longer for large ones (which have to run at least once per strategy).
+ the runner is held meanwhile, so six-step is timed on one thread: the wisdom has to hold for
+ transforms inside a worker's job too, and fft.c still sends a transform to the workers on its own
+ when they're free.
+
+ - Returns: 0 on success, 1 if the test signal couldn't be allocated (the wisdom is unchanged)
+*/
+short fft_tune(long min_log2n, long max_log2n) {
+    float* data;
+
+    if (min_log2n < 3) min_log2n = 3;
+    if (max_log2n >= FFT_MAX_LOG2) max_log2n = FFT_MAX_LOG2 - 1;
+    if (max_log2n < min_log2n) return 0;
+
+    data = (float*)malloc(sizeof(float)*(1L << max_log2n));
+    if (!data) return 1;
+
+    srand(1);
+    for (long i = 0; i < (1L << max_log2n); i++) data[i] = (float)rand()/(float)RAND_MAX - 0.5f;
+
+    fft_parallel_hold();
+
+    for (long log2n = min_log2n; log2n <= max_log2n; log2n++) {
+        int best = FFT_STRATEGY_RADIX4;
+        double best_time = 0.;
+
+        for (int strategy = FFT_STRATEGY_RADIX4; strategy <= FFT_STRATEGY_SIXSTEP; strategy++) {
+            double t;
+
+            if (strategy == FFT_STRATEGY_SIXSTEP && log2n - 1 < FFT_SIXSTEP_MIN_LOG2M) continue;
+
+            t = fft_tune_time(log2n, strategy, data);
+            if (t > 0. && (best_time == 0. || t < best_time)) {
+                best = strategy;
+                best_time = t;
+            }
+        }
+
+        fft_wisdom[log2n] = (signed char)best;
+    }
+
+    fft_parallel_release();
+    free(data);
+    return 0;
+}
+
+/**
+ @method `fft_wisdom_export`
+ write the wisdom as text, one "log2n strategy" line per tuned size
+
+ - Parameters:
+    - text: buffer to write to (may be NULL if size is 0)
+    - size: size of the buffer in bytes
+ - Returns: the length of the whole text (like snprintf; it was cut short if that's >= size)
+*/
+long fft_wisdom_export(char* text, long size) {
+    long length = 0;
+    char line[64];
+
+    for (long log2n = 0; log2n < FFT_MAX_LOG2; log2n++) {
+        long count;
+
+        if (log2n == 0) {
+            count = snprintf(line, sizeof(line), "%s\n# kernels %s\n", FFT_WISDOM_HEADER, fft_kernel_name());
+        } else if (fft_wisdom[log2n]) {
+            count = snprintf(line, sizeof(line), "%ld %s\n", log2n, fft_strategy_name(fft_wisdom[log2n]));
+        } else {
+            continue;
+        }
+
+        if (length + count < size) memcpy(text + length, line, count + 1);
+        length += count;
+    }
+
+    return length;
+}
+
+/**
+ @method `fft_wisdom_import`
+ replace the wisdom with text from `fft_wisdom_export` (unknown lines are skipped)
+
+ - Returns: 0 on success, 1 if it isn't wisdom (nothing is changed)
+*/
+short fft_wisdom_import(const char* text) {
+    size_t header = strlen(FFT_WISDOM_HEADER);
+
+    if (!text || strncmp(text, FFT_WISDOM_HEADER, header)) return 1;
+
+    memset(fft_wisdom, 0, sizeof(fft_wisdom));
+
+    for (const char* line = strchr(text, '\n'); line; line = strchr(line + 1, '\n')) {
+        char name[16];
+        long log2n;
+
+        if (sscanf(line + 1, "%ld %15s", &log2n, name) != 2) continue;
+
+        for (int strategy = FFT_STRATEGY_RADIX4; strategy <= FFT_STRATEGY_SIXSTEP; strategy++) {
+            if (!strcmp(name, fft_strategy_names[strategy])) fft_set_strategy(log2n, strategy);
+        }
+    }
+
+    return 0;
+}
+
+/* seconds per forward + inverse pair of length 2^log2n with the given strategy (0 if it failed) */
+static double fft_tune_time(long log2n, int strategy, float* data) {
+    long n = 1L << log2n;
+    signed char saved = fft_wisdom[log2n];
+    t_fft_dft_setup* forward;
+    t_fft_dft_setup* inverse;
+    t_fft_split spectrum;
+    double best = 0.;
+
+    fft_wisdom[log2n] = (signed char)strategy;
+    forward = fft_dft_setup_new(n, FFT_FORWARD);
+    inverse = fft_dft_setup_new(n, FFT_INVERSE);
+    spectrum.realp = (float*)malloc(sizeof(float)*n/2);
+    spectrum.imagp = (float*)malloc(sizeof(float)*n/2);
+
+    if (forward && inverse && spectrum.realp && spectrum.imagp) {
+        fft_ctoz(data, &spectrum, n);
+
+        /* best of three runs of at least FFT_TUNE_SECONDS each */
+        for (int run = 0; run < 3; run++) {
+            long reps = 0;
+            double start = fft_tune_now(), elapsed;
+
+            do {
+                fft_dft_execute(forward, &spectrum);
+                fft_dft_execute(inverse, &spectrum);
+                fft_vsmul(spectrum.realp, 0.5f/n, n/2);
+                fft_vsmul(spectrum.imagp, 0.5f/n, n/2);
+                reps++;
+                elapsed = fft_tune_now() - start;
+            } while (elapsed < FFT_TUNE_SECONDS);
+
+            if (best == 0. || elapsed/reps < best) best = elapsed/reps;
+        }
+    }
+
+    free(spectrum.imagp);
+    free(spectrum.realp);
+    fft_dft_setup_free(inverse);
+    fft_dft_setup_free(forward);
+    fft_wisdom[log2n] = saved;
+    return best;
+}
+
+static double fft_tune_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec;
+}
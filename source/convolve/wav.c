@@ -0,0 +1,171 @@
+/**
+    @file wav - reading .wav files a block of frames at a time
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    a .wav file is a RIFF header followed by chunks (an id, a little-endian size, then the contents,
+    padded to an even length). only two matter here: "fmt " describes the samples and "data" holds
+    them as interleaved frames. anything else (cue points, metadata, ...) is skipped.
+*/
+
+#include "wav.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WAV_READ_CHUNK 8192         // bytes converted to floats at a time
+#define WAV_FORMAT_PCM 1
+#define WAV_FORMAT_FLOAT 3
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+
+static unsigned long wav_le(const unsigned char* bytes, int count);
+static void wav_convert(const t_wav_reader* wav, const unsigned char* raw, float* samples, long count);
+
+/**
+ @method `wav_reader_open`
+ read the header of a .wav file, leaving the file at its first frame
+
+ - Parameters:
+    - wav: filled in
+    - file: an open file (it stays the caller's to close)
+ - Returns: 0 on success, 1 if it isn't a .wav file this can read
+*/
+short wav_reader_open(t_wav_reader* wav, t_filehandle file) {
+    unsigned char header[40];
+    t_ptr_size count = 12;
+    short formatted = 0;
+
+    memset(wav, 0, sizeof(t_wav_reader));
+    wav->file = file;
+
+    if (sysfile_read(file, &count, header) || count != 12 || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4)) {
+        return 1;
+    }
+
+    for (;;) {
+        unsigned long size, skip;
+
+        count = 8;
+        if (sysfile_read(file, &count, header) || count != 8) return 1;
+        size = wav_le(header + 4, 4);
+        skip = size + (size & 1);
+
+        if (!memcmp(header, "fmt ", 4)) {
+            unsigned long tag;
+
+            count = size < sizeof(header) ? size : sizeof(header);
+            if (size < 16 || sysfile_read(file, &count, header) || count < 16) return 1;
+            skip -= count;
+
+            /* the extensible format keeps the actual one at the start of its sub-format GUID */
+            tag = wav_le(header, 2);
+            if (tag == WAV_FORMAT_EXTENSIBLE && count >= 26) tag = wav_le(header + 24, 2);
+
+            wav->format = (short)tag;
+            wav->channels = (long)wav_le(header + 2, 2);
+            wav->sample_rate = (double)wav_le(header + 4, 4);
+            wav->bytes = (short)(wav_le(header + 14, 2)/8);
+            formatted = 1;
+        } else if (!memcmp(header, "data", 4)) {
+            short readable = wav->format == WAV_FORMAT_PCM ? wav->bytes >= 1 && wav->bytes <= 4
+                                                            : wav->format == WAV_FORMAT_FLOAT && wav->bytes == 4;
+
+            if (!formatted || !readable || wav->channels < 1 || wav->channels*wav->bytes > WAV_READ_CHUNK) return 1;
+            wav->frames = (long)(size/(unsigned long)(wav->channels*wav->bytes));
+            return 0;
+        }
+
+        if (skip && sysfile_setpos(file, SYSFILE_FROMMARK, (t_ptr_int)skip)) return 1;
+    }
+}
+
+/**
+ @method `wav_reader_read`
+ the next frames of the file, as floats
+
+ - Parameters:
+    - wav: from `wav_reader_open`
+    - frames: room for `count` interleaved frames
+    - count: number of frames to read
+ - Returns: the number of frames read (fewer than `count` at the end of the file)
+*/
+long wav_reader_read(t_wav_reader* wav, float* frames, long count) {
+    unsigned char raw[WAV_READ_CHUNK];
+    long frame_bytes = wav->channels*wav->bytes;
+    long done = 0;
+
+    if (count > wav->frames - wav->position) count = wav->frames - wav->position;
+
+    while (done < count) {
+        long chunk = WAV_READ_CHUNK/frame_bytes < count - done ? WAV_READ_CHUNK/frame_bytes : count - done;
+        t_ptr_size size = (t_ptr_size)(chunk*frame_bytes);
+
+        if (sysfile_read(wav->file, &size, raw)) break;
+
+        /* a truncated file ends early */
+        chunk = (long)size/frame_bytes;
+        wav_convert(wav, raw, frames + done*wav->channels, chunk*wav->channels);
+        done += chunk;
+        if ((long)size < chunk*frame_bytes || !chunk) break;
+    }
+
+    wav->position += done;
+    return done;
+}
+
+/**
+ @method `wav_read`
+ all of a .wav file
+
+ - Parameters:
+    - path, name: where it is
+    - frames, channels, sample_rate: set to the file's
+ - Returns: its interleaved frames (free with `free`), or NULL if it couldn't be read
+*/
+float* wav_read(short path, const char* name, long* frames, long* channels, double* sample_rate) {
+    t_filehandle file;
+    t_wav_reader wav;
+    float* samples = NULL;
+
+    if (path_opensysfile(name, path, &file, READ_PERM)) return NULL;
+
+    if (!wav_reader_open(&wav, file) && wav.frames > 0) {
+        samples = (float*)malloc(sizeof(float)*wav.frames*wav.channels);
+        if (samples && (*frames = wav_reader_read(&wav, samples, wav.frames)) > 0) {
+            *channels = wav.channels;
+            *sample_rate = wav.sample_rate;
+        } else {
+            free(samples);
+            samples = NULL;
+        }
+    }
+
+    sysfile_close(file);
+    return samples;
+}
+
+/* an unsigned little-endian integer of `count` bytes */
+static unsigned long wav_le(const unsigned char* bytes, int count) {
+    unsigned long value = 0;
+
+    while (count--) value = value << 8 | bytes[count];
+    return value;
+}
+
+/* `count` samples in the file's format to floats */
+static void wav_convert(const t_wav_reader* wav, const unsigned char* raw, float* samples, long count) {
+    int bytes = wav->bytes;
+
+    for (long i = 0; i < count; i++, raw += bytes) {
+        uint32_t word = (uint32_t)wav_le(raw, bytes);
+
+        if (wav->format == WAV_FORMAT_FLOAT) {
+            memcpy(samples + i, &word, sizeof(float));
+        } else if (bytes == 1) {
+            /* 8-bit samples are unsigned */
+            samples[i] = ((float)word - 128.f)/128.f;
+        } else {
+            samples[i] = (float)(int32_t)(word << (32 - 8*bytes))/2147483648.f;
+        }
+    }
+}
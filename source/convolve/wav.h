@@ -0,0 +1,37 @@
+/**
+    @file wav - reading .wav files a block of frames at a time
+    @author isaiahdoyle - isaiahdoyle56@gmail.com
+
+    for impulse responses and signals that aren't in a buffer~. integer PCM (8 to 32 bits) and 32-bit
+    float files are read, including WAVE_FORMAT_EXTENSIBLE ones; the samples come out as interleaved
+    floats in [-1, 1). files are read through sysfile, so (unlike fft.h and conv.h) this needs Max.
+*/
+
+#ifndef CONVOLVE_WAV_H
+#define CONVOLVE_WAV_H
+
+#include "ext.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _wav_reader {
+    t_filehandle    file;
+    long            channels;
+    long            frames;         // in the data chunk
+    long            position;       // frames read so far
+    double          sample_rate;
+    short           format;         // 1: integer PCM, 3: float
+    short           bytes;          // per sample
+} t_wav_reader;
+
+short wav_reader_open(t_wav_reader* wav, t_filehandle file);
+long wav_reader_read(t_wav_reader* wav, float* frames, long count);
+float* wav_read(short path, const char* name, long* frames, long* channels, double* sample_rate);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONVOLVE_WAV_H */